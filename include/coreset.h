@@ -0,0 +1,40 @@
+#ifndef CORESET_H
+#define CORESET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+#include "matrix.h"
+
+// coreset 构建的配置
+struct CoresetOptions
+{
+    // 期望的 coreset 大小。每个样本独立地以 min(1, size·q(x)) 的概率入选，实际行数是随机的，期望约为 size
+    // （p 被截断到 1 的样本使期望略小于 size），可能少于后续 KMeans 的 k，调用方应检查 points.rows()
+    std::size_t size = 10000;
+    // 估计参考中心使用的均匀抽样行数，样本数不超过它时直接使用全部数据
+    std::size_t pilot_size = 65536;
+    // 采样扫描使用的线程数，0 表示使用全部硬件线程；结果与线程数无关
+    int num_threads = 1;
+    // 随机数种子，未设置时使用 std::random_device
+    std::optional<std::uint64_t> seed;
+};
+
+// 加权点集：points 的第 i 行对应原数据的第 indices[i] 行，权重为 weights[i]
+template <typename T>
+struct Coreset
+{
+    Matrix<T> points;
+    std::vector<double> weights;
+    std::vector<std::size_t> indices;
+};
+
+// 轻量级 coreset（Bachem 等，敏感度采样）：以 q(x) = 1/(2n) + d(x, μ)^2 / (2 Σ d(x', μ)^2) 为重要性采样，
+// 入选样本的权重为 1 / p(x)，使任意 k 个中心下的加权代价都是全量代价的无偏估计。
+// μ 与 Σ d^2 由少量均匀抽样行估计，之后只需对全部数据做一次并行扫描；得到的加权点集可直接交给
+// KMeans::fit(data, weights)。没有任何样本入选时抛出 std::runtime_error
+Coreset<float> build_coreset(const MatrixView<float> &data, const CoresetOptions &options = CoresetOptions());
+Coreset<double> build_coreset(const MatrixView<double> &data, const CoresetOptions &options = CoresetOptions());
+
+#endif // CORESET_H
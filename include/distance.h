@@ -0,0 +1,535 @@
+#ifndef DISTANCE_H
+#define DISTANCE_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include "matrix.h"
+
+#if defined(__AVX__) || defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+// 向量化的距离内核。按编译器开启的指令集选择 AVX / SSE2 实现，
+// 其他平台退回到多累加器的标量循环（便于编译器自动向量化）
+namespace simd
+{
+#if defined(__AVX__)
+    inline float hsum(__m256 v)
+    {
+        __m128 lo = _mm256_castps256_ps128(v);
+        __m128 hi = _mm256_extractf128_ps(v, 1);
+        lo = _mm_add_ps(lo, hi);
+        lo = _mm_add_ps(lo, _mm_movehl_ps(lo, lo));
+        lo = _mm_add_ss(lo, _mm_shuffle_ps(lo, lo, 0x55));
+        return _mm_cvtss_f32(lo);
+    }
+
+    inline double hsum(__m256d v)
+    {
+        __m128d lo = _mm256_castpd256_pd128(v);
+        __m128d hi = _mm256_extractf128_pd(v, 1);
+        lo = _mm_add_pd(lo, hi);
+        lo = _mm_add_sd(lo, _mm_unpackhi_pd(lo, lo));
+        return _mm_cvtsd_f64(lo);
+    }
+
+#if defined(__FMA__)
+#define ML_SIMD_FMADD_PS(a, b, c) _mm256_fmadd_ps(a, b, c)
+#define ML_SIMD_FMADD_PD(a, b, c) _mm256_fmadd_pd(a, b, c)
+#else
+#define ML_SIMD_FMADD_PS(a, b, c) _mm256_add_ps(_mm256_mul_ps(a, b), c)
+#define ML_SIMD_FMADD_PD(a, b, c) _mm256_add_pd(_mm256_mul_pd(a, b), c)
+#endif
+#elif defined(__SSE2__) || defined(_M_X64)
+    inline float hsum(__m128 v)
+    {
+        v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+        v = _mm_add_ss(v, _mm_shuffle_ps(v, v, 0x55));
+        return _mm_cvtss_f32(v);
+    }
+
+    inline double hsum(__m128d v)
+    {
+        return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v)));
+    }
+#endif
+
+    // 平方欧氏距离 ||a - b||^2
+    inline float squared_l2(const float *a, const float *b, std::size_t d)
+    {
+        std::size_t j = 0;
+        float sum = 0.0f;
+#if defined(__AVX__)
+        __m256 acc0 = _mm256_setzero_ps();
+        __m256 acc1 = _mm256_setzero_ps();
+        for (; j + 16 <= d; j += 16)
+        {
+            __m256 d0 = _mm256_sub_ps(_mm256_loadu_ps(a + j), _mm256_loadu_ps(b + j));
+            __m256 d1 = _mm256_sub_ps(_mm256_loadu_ps(a + j + 8), _mm256_loadu_ps(b + j + 8));
+            acc0 = ML_SIMD_FMADD_PS(d0, d0, acc0);
+            acc1 = ML_SIMD_FMADD_PS(d1, d1, acc1);
+        }
+        for (; j + 8 <= d; j += 8)
+        {
+            __m256 d0 = _mm256_sub_ps(_mm256_loadu_ps(a + j), _mm256_loadu_ps(b + j));
+            acc0 = ML_SIMD_FMADD_PS(d0, d0, acc0);
+        }
+        sum = hsum(_mm256_add_ps(acc0, acc1));
+#elif defined(__SSE2__) || defined(_M_X64)
+        __m128 acc0 = _mm_setzero_ps();
+        __m128 acc1 = _mm_setzero_ps();
+        for (; j + 8 <= d; j += 8)
+        {
+            __m128 d0 = _mm_sub_ps(_mm_loadu_ps(a + j), _mm_loadu_ps(b + j));
+            __m128 d1 = _mm_sub_ps(_mm_loadu_ps(a + j + 4), _mm_loadu_ps(b + j + 4));
+            acc0 = _mm_add_ps(_mm_mul_ps(d0, d0), acc0);
+            acc1 = _mm_add_ps(_mm_mul_ps(d1, d1), acc1);
+        }
+        sum = hsum(_mm_add_ps(acc0, acc1));
+#endif
+        for (; j < d; ++j)
+        {
+            float diff = a[j] - b[j];
+            sum += diff * diff;
+        }
+        return sum;
+    }
+
+    inline double squared_l2(const double *a, const double *b, std::size_t d)
+    {
+        std::size_t j = 0;
+        double sum = 0.0;
+#if defined(__AVX__)
+        __m256d acc0 = _mm256_setzero_pd();
+        __m256d acc1 = _mm256_setzero_pd();
+        for (; j + 8 <= d; j += 8)
+        {
+            __m256d d0 = _mm256_sub_pd(_mm256_loadu_pd(a + j), _mm256_loadu_pd(b + j));
+            __m256d d1 = _mm256_sub_pd(_mm256_loadu_pd(a + j + 4), _mm256_loadu_pd(b + j + 4));
+            acc0 = ML_SIMD_FMADD_PD(d0, d0, acc0);
+            acc1 = ML_SIMD_FMADD_PD(d1, d1, acc1);
+        }
+        for (; j + 4 <= d; j += 4)
+        {
+            __m256d d0 = _mm256_sub_pd(_mm256_loadu_pd(a + j), _mm256_loadu_pd(b + j));
+            acc0 = ML_SIMD_FMADD_PD(d0, d0, acc0);
+        }
+        sum = hsum(_mm256_add_pd(acc0, acc1));
+#elif defined(__SSE2__) || defined(_M_X64)
+        __m128d acc0 = _mm_setzero_pd();
+        __m128d acc1 = _mm_setzero_pd();
+        for (; j + 4 <= d; j += 4)
+        {
+            __m128d d0 = _mm_sub_pd(_mm_loadu_pd(a + j), _mm_loadu_pd(b + j));
+            __m128d d1 = _mm_sub_pd(_mm_loadu_pd(a + j + 2), _mm_loadu_pd(b + j + 2));
+            acc0 = _mm_add_pd(_mm_mul_pd(d0, d0), acc0);
+            acc1 = _mm_add_pd(_mm_mul_pd(d1, d1), acc1);
+        }
+        sum = hsum(_mm_add_pd(acc0, acc1));
+#endif
+        for (; j < d; ++j)
+        {
+            double diff = a[j] - b[j];
+            sum += diff * diff;
+        }
+        return sum;
+    }
+
+    // 曼哈顿距离 sum_j |a_j - b_j|，用清除符号位的方式取绝对值
+    inline float l1(const float *a, const float *b, std::size_t d)
+    {
+        std::size_t j = 0;
+        float sum = 0.0f;
+#if defined(__AVX__)
+        const __m256 sign = _mm256_set1_ps(-0.0f);
+        __m256 acc0 = _mm256_setzero_ps();
+        __m256 acc1 = _mm256_setzero_ps();
+        for (; j + 16 <= d; j += 16)
+        {
+            __m256 d0 = _mm256_sub_ps(_mm256_loadu_ps(a + j), _mm256_loadu_ps(b + j));
+            __m256 d1 = _mm256_sub_ps(_mm256_loadu_ps(a + j + 8), _mm256_loadu_ps(b + j + 8));
+            acc0 = _mm256_add_ps(acc0, _mm256_andnot_ps(sign, d0));
+            acc1 = _mm256_add_ps(acc1, _mm256_andnot_ps(sign, d1));
+        }
+        for (; j + 8 <= d; j += 8)
+        {
+            __m256 d0 = _mm256_sub_ps(_mm256_loadu_ps(a + j), _mm256_loadu_ps(b + j));
+            acc0 = _mm256_add_ps(acc0, _mm256_andnot_ps(sign, d0));
+        }
+        sum = hsum(_mm256_add_ps(acc0, acc1));
+#elif defined(__SSE2__) || defined(_M_X64)
+        const __m128 sign = _mm_set1_ps(-0.0f);
+        __m128 acc0 = _mm_setzero_ps();
+        for (; j + 4 <= d; j += 4)
+        {
+            __m128 d0 = _mm_sub_ps(_mm_loadu_ps(a + j), _mm_loadu_ps(b + j));
+            acc0 = _mm_add_ps(acc0, _mm_andnot_ps(sign, d0));
+        }
+        sum = hsum(acc0);
+#endif
+        for (; j < d; ++j)
+        {
+            sum += std::fabs(a[j] - b[j]);
+        }
+        return sum;
+    }
+
+    inline double l1(const double *a, const double *b, std::size_t d)
+    {
+        std::size_t j = 0;
+        double sum = 0.0;
+#if defined(__AVX__)
+        const __m256d sign = _mm256_set1_pd(-0.0);
+        __m256d acc0 = _mm256_setzero_pd();
+        __m256d acc1 = _mm256_setzero_pd();
+        for (; j + 8 <= d; j += 8)
+        {
+            __m256d d0 = _mm256_sub_pd(_mm256_loadu_pd(a + j), _mm256_loadu_pd(b + j));
+            __m256d d1 = _mm256_sub_pd(_mm256_loadu_pd(a + j + 4), _mm256_loadu_pd(b + j + 4));
+            acc0 = _mm256_add_pd(acc0, _mm256_andnot_pd(sign, d0));
+            acc1 = _mm256_add_pd(acc1, _mm256_andnot_pd(sign, d1));
+        }
+        for (; j + 4 <= d; j += 4)
+        {
+            __m256d d0 = _mm256_sub_pd(_mm256_loadu_pd(a + j), _mm256_loadu_pd(b + j));
+            acc0 = _mm256_add_pd(acc0, _mm256_andnot_pd(sign, d0));
+        }
+        sum = hsum(_mm256_add_pd(acc0, acc1));
+#elif defined(__SSE2__) || defined(_M_X64)
+        const __m128d sign = _mm_set1_pd(-0.0);
+        __m128d acc0 = _mm_setzero_pd();
+        for (; j + 2 <= d; j += 2)
+        {
+            __m128d d0 = _mm_sub_pd(_mm_loadu_pd(a + j), _mm_loadu_pd(b + j));
+            acc0 = _mm_add_pd(acc0, _mm_andnot_pd(sign, d0));
+        }
+        sum = hsum(acc0);
+#endif
+        for (; j < d; ++j)
+        {
+            sum += std::fabs(a[j] - b[j]);
+        }
+        return sum;
+    }
+
+    // 内积 a·b
+    inline float dot(const float *a, const float *b, std::size_t d)
+    {
+        std::size_t j = 0;
+        float sum = 0.0f;
+#if defined(__AVX__)
+        __m256 acc0 = _mm256_setzero_ps();
+        __m256 acc1 = _mm256_setzero_ps();
+        for (; j + 16 <= d; j += 16)
+        {
+            acc0 = ML_SIMD_FMADD_PS(_mm256_loadu_ps(a + j), _mm256_loadu_ps(b + j), acc0);
+            acc1 = ML_SIMD_FMADD_PS(_mm256_loadu_ps(a + j + 8), _mm256_loadu_ps(b + j + 8), acc1);
+        }
+        for (; j + 8 <= d; j += 8)
+        {
+            acc0 = ML_SIMD_FMADD_PS(_mm256_loadu_ps(a + j), _mm256_loadu_ps(b + j), acc0);
+        }
+        sum = hsum(_mm256_add_ps(acc0, acc1));
+#elif defined(__SSE2__) || defined(_M_X64)
+        __m128 acc0 = _mm_setzero_ps();
+        __m128 acc1 = _mm_setzero_ps();
+        for (; j + 8 <= d; j += 8)
+        {
+            acc0 = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(a + j), _mm_loadu_ps(b + j)), acc0);
+            acc1 = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(a + j + 4), _mm_loadu_ps(b + j + 4)), acc1);
+        }
+        sum = hsum(_mm_add_ps(acc0, acc1));
+#endif
+        for (; j < d; ++j)
+        {
+            sum += a[j] * b[j];
+        }
+        return sum;
+    }
+
+    inline double dot(const double *a, const double *b, std::size_t d)
+    {
+        std::size_t j = 0;
+        double sum = 0.0;
+#if defined(__AVX__)
+        __m256d acc0 = _mm256_setzero_pd();
+        __m256d acc1 = _mm256_setzero_pd();
+        for (; j + 8 <= d; j += 8)
+        {
+            acc0 = ML_SIMD_FMADD_PD(_mm256_loadu_pd(a + j), _mm256_loadu_pd(b + j), acc0);
+            acc1 = ML_SIMD_FMADD_PD(_mm256_loadu_pd(a + j + 4), _mm256_loadu_pd(b + j + 4), acc1);
+        }
+        for (; j + 4 <= d; j += 4)
+        {
+            acc0 = ML_SIMD_FMADD_PD(_mm256_loadu_pd(a + j), _mm256_loadu_pd(b + j), acc0);
+        }
+        sum = hsum(_mm256_add_pd(acc0, acc1));
+#elif defined(__SSE2__) || defined(_M_X64)
+        __m128d acc0 = _mm_setzero_pd();
+        __m128d acc1 = _mm_setzero_pd();
+        for (; j + 4 <= d; j += 4)
+        {
+            acc0 = _mm_add_pd(_mm_mul_pd(_mm_loadu_pd(a + j), _mm_loadu_pd(b + j)), acc0);
+            acc1 = _mm_add_pd(_mm_mul_pd(_mm_loadu_pd(a + j + 2), _mm_loadu_pd(b + j + 2)), acc1);
+        }
+        sum = hsum(_mm_add_pd(acc0, acc1));
+#endif
+        for (; j < d; ++j)
+        {
+            sum += a[j] * b[j];
+        }
+        return sum;
+    }
+
+    // 一个向量与四个向量的内积：out[t] = x·c_t。x 只读取一次，四条累加链互不依赖，
+    // 是分块距离计算（GEMM 形式）的微内核
+    inline void dot_1x4(const float *x, const float *c0, const float *c1, const float *c2, const float *c3,
+                        std::size_t d, float *out)
+    {
+        std::size_t j = 0;
+        float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f;
+#if defined(__AVX__)
+        __m256 acc0 = _mm256_setzero_ps();
+        __m256 acc1 = _mm256_setzero_ps();
+        __m256 acc2 = _mm256_setzero_ps();
+        __m256 acc3 = _mm256_setzero_ps();
+        for (; j + 8 <= d; j += 8)
+        {
+            __m256 xv = _mm256_loadu_ps(x + j);
+            acc0 = ML_SIMD_FMADD_PS(xv, _mm256_loadu_ps(c0 + j), acc0);
+            acc1 = ML_SIMD_FMADD_PS(xv, _mm256_loadu_ps(c1 + j), acc1);
+            acc2 = ML_SIMD_FMADD_PS(xv, _mm256_loadu_ps(c2 + j), acc2);
+            acc3 = ML_SIMD_FMADD_PS(xv, _mm256_loadu_ps(c3 + j), acc3);
+        }
+        s0 = hsum(acc0);
+        s1 = hsum(acc1);
+        s2 = hsum(acc2);
+        s3 = hsum(acc3);
+#elif defined(__SSE2__) || defined(_M_X64)
+        __m128 acc0 = _mm_setzero_ps();
+        __m128 acc1 = _mm_setzero_ps();
+        __m128 acc2 = _mm_setzero_ps();
+        __m128 acc3 = _mm_setzero_ps();
+        for (; j + 4 <= d; j += 4)
+        {
+            __m128 xv = _mm_loadu_ps(x + j);
+            acc0 = _mm_add_ps(_mm_mul_ps(xv, _mm_loadu_ps(c0 + j)), acc0);
+            acc1 = _mm_add_ps(_mm_mul_ps(xv, _mm_loadu_ps(c1 + j)), acc1);
+            acc2 = _mm_add_ps(_mm_mul_ps(xv, _mm_loadu_ps(c2 + j)), acc2);
+            acc3 = _mm_add_ps(_mm_mul_ps(xv, _mm_loadu_ps(c3 + j)), acc3);
+        }
+        s0 = hsum(acc0);
+        s1 = hsum(acc1);
+        s2 = hsum(acc2);
+        s3 = hsum(acc3);
+#endif
+        for (; j < d; ++j)
+        {
+            s0 += x[j] * c0[j];
+            s1 += x[j] * c1[j];
+            s2 += x[j] * c2[j];
+            s3 += x[j] * c3[j];
+        }
+        out[0] = s0;
+        out[1] = s1;
+        out[2] = s2;
+        out[3] = s3;
+    }
+
+    inline void dot_1x4(const double *x, const double *c0, const double *c1, const double *c2, const double *c3,
+                        std::size_t d, double *out)
+    {
+        std::size_t j = 0;
+        double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+#if defined(__AVX__)
+        __m256d acc0 = _mm256_setzero_pd();
+        __m256d acc1 = _mm256_setzero_pd();
+        __m256d acc2 = _mm256_setzero_pd();
+        __m256d acc3 = _mm256_setzero_pd();
+        for (; j + 4 <= d; j += 4)
+        {
+            __m256d xv = _mm256_loadu_pd(x + j);
+            acc0 = ML_SIMD_FMADD_PD(xv, _mm256_loadu_pd(c0 + j), acc0);
+            acc1 = ML_SIMD_FMADD_PD(xv, _mm256_loadu_pd(c1 + j), acc1);
+            acc2 = ML_SIMD_FMADD_PD(xv, _mm256_loadu_pd(c2 + j), acc2);
+            acc3 = ML_SIMD_FMADD_PD(xv, _mm256_loadu_pd(c3 + j), acc3);
+        }
+        s0 = hsum(acc0);
+        s1 = hsum(acc1);
+        s2 = hsum(acc2);
+        s3 = hsum(acc3);
+#elif defined(__SSE2__) || defined(_M_X64)
+        __m128d acc0 = _mm_setzero_pd();
+        __m128d acc1 = _mm_setzero_pd();
+        __m128d acc2 = _mm_setzero_pd();
+        __m128d acc3 = _mm_setzero_pd();
+        for (; j + 2 <= d; j += 2)
+        {
+            __m128d xv = _mm_loadu_pd(x + j);
+            acc0 = _mm_add_pd(_mm_mul_pd(xv, _mm_loadu_pd(c0 + j)), acc0);
+            acc1 = _mm_add_pd(_mm_mul_pd(xv, _mm_loadu_pd(c1 + j)), acc1);
+            acc2 = _mm_add_pd(_mm_mul_pd(xv, _mm_loadu_pd(c2 + j)), acc2);
+            acc3 = _mm_add_pd(_mm_mul_pd(xv, _mm_loadu_pd(c3 + j)), acc3);
+        }
+        s0 = hsum(acc0);
+        s1 = hsum(acc1);
+        s2 = hsum(acc2);
+        s3 = hsum(acc3);
+#endif
+        for (; j < d; ++j)
+        {
+            s0 += x[j] * c0[j];
+            s1 += x[j] * c1[j];
+            s2 += x[j] * c2[j];
+            s3 += x[j] * c3[j];
+        }
+        out[0] = s0;
+        out[1] = s1;
+        out[2] = s2;
+        out[3] = s3;
+    }
+
+    // 分块内积 out[r * ldo + c] = X_r · C_c，X 为 m 行、C 为 kc 行的行优先矩阵（行长均为 d）。
+    // 调用方负责把 X 和 C 的块大小控制在缓存内
+    template <typename T>
+    inline void dot_block(const T *X, std::size_t m, const T *C, std::size_t kc, std::size_t d,
+                          T *out, std::size_t ldo)
+    {
+        for (std::size_t r = 0; r < m; ++r)
+        {
+            const T *x = X + r * d;
+            T *row = out + r * ldo;
+            std::size_t c = 0;
+            for (; c + 4 <= kc; c += 4)
+            {
+                dot_1x4(x, C + c * d, C + (c + 1) * d, C + (c + 2) * d, C + (c + 3) * d, d, row + c);
+            }
+            for (; c < kc; ++c)
+            {
+                row[c] = dot(x, C + c * d, d);
+            }
+        }
+    }
+
+    // 乘积量化的查表距离：out[i] = sum_s lut[s * ksub + codes[s][i]], i ∈ [0, n)。
+    // codes[s] 为第 s 个子空间的编码数组（按子空间分开存放，同一子空间的编码连续），
+    // AVX2 下一次取 8 个编码扩展为下标后用 gather 查表
+    inline void pq_scan(const float *lut, std::size_t ksub, const std::uint8_t *const *codes, std::size_t m,
+                        std::size_t n, float *out)
+    {
+        std::size_t i = 0;
+#if defined(__AVX2__)
+        for (; i + 8 <= n; i += 8)
+        {
+            __m256 acc = _mm256_setzero_ps();
+            for (std::size_t s = 0; s < m; ++s)
+            {
+                __m128i packed = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(codes[s] + i));
+                __m256i idx = _mm256_cvtepu8_epi32(packed);
+                acc = _mm256_add_ps(acc, _mm256_i32gather_ps(lut + s * ksub, idx, 4));
+            }
+            _mm256_storeu_ps(out + i, acc);
+        }
+#endif
+        for (; i < n; ++i)
+        {
+            float sum = 0.0f;
+            for (std::size_t s = 0; s < m; ++s)
+            {
+                sum += lut[s * ksub + codes[s][i]];
+            }
+            out[i] = sum;
+        }
+    }
+
+    // y += alpha * x，循环简单且无别名，交给编译器自动向量化
+    template <typename T>
+    inline void axpy(T alpha, const T *x, T *__restrict y, std::size_t d)
+    {
+        for (std::size_t j = 0; j < d; ++j)
+        {
+            y[j] += alpha * x[j];
+        }
+    }
+
+    // 稀疏向量（nnz 个 (idx, val) 对）与稠密向量的内积，只访问非零元素对应的分量，按 dense 的精度累加。
+    // 四路独立累加打断加法的依赖链，随机访问 dense 的延迟可以相互重叠
+    template <typename T, typename U>
+    inline U sparse_dot(const std::uint32_t *idx, const T *val, std::size_t nnz, const U *dense)
+    {
+        U s0 = U(0), s1 = U(0), s2 = U(0), s3 = U(0);
+        std::size_t p = 0;
+        for (; p + 4 <= nnz; p += 4)
+        {
+            s0 += val[p] * dense[idx[p]];
+            s1 += val[p + 1] * dense[idx[p + 1]];
+            s2 += val[p + 2] * dense[idx[p + 2]];
+            s3 += val[p + 3] * dense[idx[p + 3]];
+        }
+        for (; p < nnz; ++p)
+        {
+            s0 += val[p] * dense[idx[p]];
+        }
+        return (s0 + s1) + (s2 + s3);
+    }
+
+    // dense[idx[p]] += alpha * val[p]：把稀疏向量的倍数累加到稠密向量
+    template <typename T, typename U>
+    inline void sparse_axpy(const std::uint32_t *idx, const T *val, std::size_t nnz, U alpha, U *dense)
+    {
+        for (std::size_t p = 0; p < nnz; ++p)
+        {
+            dense[idx[p]] += alpha * static_cast<U>(val[p]);
+        }
+    }
+
+    // 列优先（SoA）数据块到一个中心的平方距离：
+    // out[i] = sum_j (X[j * ld + i] - c[j])^2, i ∈ [0, n)
+    // 内层循环沿样本方向连续访问，编译器可以直接向量化
+    template <typename T>
+    inline void squared_l2_colmajor(const T *X, std::size_t ld, std::size_t n,
+                                    const T *c, std::size_t d, T *__restrict out)
+    {
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            out[i] = T(0);
+        }
+        for (std::size_t j = 0; j < d; ++j)
+        {
+            const T *col = X + j * ld;
+            const T cj = c[j];
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                T diff = col[i] - cj;
+                out[i] += diff * diff;
+            }
+        }
+    }
+
+    // 步长不为 1 的数据（列优先视图中的单个样本）到中心的平方距离
+    template <typename T>
+    inline T squared_l2_strided(const T *x, std::size_t stride, const T *c, std::size_t d)
+    {
+        T sum = T(0);
+        for (std::size_t j = 0; j < d; ++j)
+        {
+            T diff = x[j * stride] - c[j];
+            sum += diff * diff;
+        }
+        return sum;
+    }
+
+    // 矩阵视图中第 i 个样本到中心 c 的平方距离，行优先时走连续 SIMD 内核
+    template <typename T>
+    inline T squared_l2(const MatrixView<T> &data, std::size_t i, const T *c)
+    {
+        if (data.row_major())
+        {
+            return squared_l2(data.row(i), c, data.cols());
+        }
+        return squared_l2_strided(data.data() + i, data.ld(), c, data.cols());
+    }
+}
+
+#endif // DISTANCE_H
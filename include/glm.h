@@ -0,0 +1,235 @@
+#ifndef GLM_H
+#define GLM_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include "distance.h"
+
+// 广义线性模型的族，均使用典范连接函数
+enum class GlmFamily
+{
+    Gaussian, // 恒等连接，平方损失（线性回归）
+    Logistic, // logit 连接，伯努利分布的负对数似然，y ∈ [0, 1]
+    Poisson,  // 对数连接，泊松分布的负对数似然（省略只与 y 有关的常数），y >= 0
+    Softmax   // 多分类：K 个线性预测经 softmax 得到类别概率，交叉熵损失，y 为类别编号
+};
+
+// GLM 的族策略。典范连接下负对数似然对线性预测 η = x·w + b 的导数都是 μ(η) - y（μ 为连接函数的反函数），
+// 因此梯度下降的各个调度只需把残差 η - y 换成 μ(η) - y。每个族提供标量版本和 AVX2 的 4 路版本，
+// residuals 在一次向量化循环中把一块 η 换成残差并按需累加损失
+namespace glm
+{
+#if defined(__AVX2__)
+    // e^x，相对误差约 1e-15。x 截断到 [-708, 709]，结果保持为正规数：
+    // x = n·ln2 + r，|r| <= ln2 / 2，e^r 用 12 阶 Taylor 多项式，2^n 直接拼出指数位
+    inline __m256d exp_pd(__m256d x)
+    {
+        x = _mm256_max_pd(_mm256_min_pd(x, _mm256_set1_pd(709.0)), _mm256_set1_pd(-708.0));
+        const __m256d n = _mm256_round_pd(_mm256_mul_pd(x, _mm256_set1_pd(1.4426950408889634)),
+                                          _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        // ln2 拆成高低两部分，n·ln2_hi 没有舍入误差
+        __m256d r = _mm256_sub_pd(x, _mm256_mul_pd(n, _mm256_set1_pd(6.93145751953125e-1)));
+        r = _mm256_sub_pd(r, _mm256_mul_pd(n, _mm256_set1_pd(1.42860682030941723212e-6)));
+        static constexpr double kInvFactorial[] = {
+            1.0 / 479001600.0, 1.0 / 39916800.0, 1.0 / 3628800.0, 1.0 / 362880.0, 1.0 / 40320.0, 1.0 / 5040.0,
+            1.0 / 720.0, 1.0 / 120.0, 1.0 / 24.0, 1.0 / 6.0, 0.5, 1.0, 1.0};
+        __m256d p = _mm256_set1_pd(kInvFactorial[0]);
+        for (std::size_t k = 1; k < sizeof(kInvFactorial) / sizeof(double); ++k)
+        {
+            p = ML_SIMD_FMADD_PD(p, r, _mm256_set1_pd(kInvFactorial[k]));
+        }
+        const __m256i biased = _mm256_add_epi64(_mm256_cvtepi32_epi64(_mm256_cvtpd_epi32(n)), _mm256_set1_epi64x(1023));
+        return _mm256_mul_pd(p, _mm256_castsi256_pd(_mm256_slli_epi64(biased, 52)));
+    }
+
+    // log(1 + u)，只对 u ∈ [0, 1] 有效（softplus 中 u = e^{-|η|}）。
+    // 1 + u > √2 时改写为 2·(1 + u) / 2，使 s = (z - 1) / (z + 1) 满足 |s| <= 0.172，
+    // 再用 log z = 2·atanh(s) = 2s(1 + s²/3 + s⁴/5 + ...) 的前 12 项
+    inline __m256d log1p_unit_pd(__m256d u)
+    {
+        const __m256d one = _mm256_set1_pd(1.0);
+        const __m256d halve = _mm256_cmp_pd(u, _mm256_set1_pd(0.41421356237309515), _CMP_GT_OQ);
+        // 不折半时 s = u / (u + 2)，折半时 s = (u - 1) / (u + 3)，都不经过 1 + u 的舍入
+        const __m256d num = _mm256_blendv_pd(u, _mm256_sub_pd(u, one), halve);
+        const __m256d den = _mm256_add_pd(u, _mm256_blendv_pd(_mm256_set1_pd(2.0), _mm256_set1_pd(3.0), halve));
+        const __m256d s = _mm256_div_pd(num, den);
+        const __m256d s2 = _mm256_mul_pd(s, s);
+        __m256d p = _mm256_set1_pd(1.0 / 23.0);
+        for (int k = 21; k >= 3; k -= 2)
+        {
+            p = ML_SIMD_FMADD_PD(p, s2, _mm256_set1_pd(1.0 / k));
+        }
+        p = ML_SIMD_FMADD_PD(p, s2, one);
+        const __m256d log_z = _mm256_mul_pd(_mm256_add_pd(s, s), p);
+        return _mm256_add_pd(log_z, _mm256_and_pd(halve, _mm256_set1_pd(0.69314718055994530942)));
+    }
+
+    inline __m256d abs_pd(__m256d x)
+    {
+        return _mm256_andnot_pd(_mm256_set1_pd(-0.0), x);
+    }
+#endif
+
+    // v[0, n) 原地取 e^v
+    inline void exp_inplace(double *v, std::size_t n)
+    {
+        std::size_t i = 0;
+#if defined(__AVX2__)
+        for (; i + 4 <= n; i += 4)
+        {
+            _mm256_storeu_pd(v + i, exp_pd(_mm256_loadu_pd(v + i)));
+        }
+#endif
+        for (; i < n; ++i)
+        {
+            v[i] = std::exp(v[i]);
+        }
+    }
+
+    struct Gaussian
+    {
+        static bool valid(double y) { return std::isfinite(y); }
+        static double residual(double eta, double y) { return eta - y; }
+        static double loss(double eta, double y) { return 0.5 * (eta - y) * (eta - y); }
+#if defined(__AVX2__)
+        static void lane(__m256d eta, __m256d y, __m256d &residual, __m256d &loss)
+        {
+            residual = _mm256_sub_pd(eta, y);
+            loss = _mm256_mul_pd(_mm256_set1_pd(0.5), _mm256_mul_pd(residual, residual));
+        }
+#endif
+    };
+
+    // μ = σ(η)，损失 softplus(η) - yη = max(η, 0) + log(1 + e^{-|η|}) - yη，对任意 η 都不溢出
+    struct Logistic
+    {
+        static bool valid(double y) { return y >= 0.0 && y <= 1.0; }
+        static double residual(double eta, double y)
+        {
+            const double t = std::exp(-std::abs(eta));
+            return (eta >= 0.0 ? 1.0 : t) / (1.0 + t) - y;
+        }
+        static double loss(double eta, double y)
+        {
+            return std::max(eta, 0.0) + std::log1p(std::exp(-std::abs(eta))) - y * eta;
+        }
+#if defined(__AVX2__)
+        static void lane(__m256d eta, __m256d y, __m256d &residual, __m256d &loss)
+        {
+            const __m256d t = exp_pd(_mm256_sub_pd(_mm256_setzero_pd(), abs_pd(eta)));
+            const __m256d one = _mm256_set1_pd(1.0);
+            const __m256d positive = _mm256_cmp_pd(eta, _mm256_setzero_pd(), _CMP_GE_OQ);
+            const __m256d mu = _mm256_div_pd(_mm256_blendv_pd(t, one, positive), _mm256_add_pd(one, t));
+            residual = _mm256_sub_pd(mu, y);
+            const __m256d softplus = _mm256_add_pd(_mm256_max_pd(eta, _mm256_setzero_pd()), log1p_unit_pd(t));
+            loss = _mm256_sub_pd(softplus, _mm256_mul_pd(y, eta));
+        }
+#endif
+    };
+
+    // μ = e^η，损失 e^η - yη；η 与 exp_pd 一样夹到 [-708, 709]，标量与向量路径结果一致
+    struct Poisson
+    {
+        static bool valid(double y) { return y >= 0.0 && std::isfinite(y); }
+        static double mean(double eta) { return std::exp(std::clamp(eta, -708.0, 709.0)); }
+        static double residual(double eta, double y) { return mean(eta) - y; }
+        static double loss(double eta, double y) { return mean(eta) - y * eta; }
+#if defined(__AVX2__)
+        static void lane(__m256d eta, __m256d y, __m256d &residual, __m256d &loss)
+        {
+            const __m256d mu = exp_pd(eta);
+            residual = _mm256_sub_pd(mu, y);
+            loss = _mm256_sub_pd(mu, _mm256_mul_pd(y, eta));
+        }
+#endif
+    };
+
+    template <typename Family, bool WithLoss>
+    inline double residuals_impl(double *r, const double *y, std::size_t n)
+    {
+        std::size_t i = 0;
+        double sum = 0.0;
+#if defined(__AVX2__)
+        __m256d acc = _mm256_setzero_pd();
+        for (; i + 4 <= n; i += 4)
+        {
+            __m256d residual, nll;
+            Family::lane(_mm256_loadu_pd(r + i), _mm256_loadu_pd(y + i), residual, nll);
+            _mm256_storeu_pd(r + i, residual);
+            // 不需要损失时 nll 没有使用者，内联后它的计算被编译器消去
+            if constexpr (WithLoss)
+            {
+                acc = _mm256_add_pd(acc, nll);
+            }
+        }
+        sum = simd::hsum(acc);
+#endif
+        for (; i < n; ++i)
+        {
+            if constexpr (WithLoss)
+            {
+                sum += Family::loss(r[i], y[i]);
+            }
+            r[i] = Family::residual(r[i], y[i]);
+        }
+        return sum;
+    }
+
+    // r[0, n) 输入线性预测 η，原地换成残差 μ(η) - y；loss 非空时累加负对数似然之和
+    template <typename Family>
+    inline void residuals(double *r, const double *y, std::size_t n, double *loss)
+    {
+        if (loss)
+        {
+            *loss += residuals_impl<Family, true>(r, y, n);
+        }
+        else
+        {
+            residuals_impl<Family, false>(r, y, n);
+        }
+    }
+
+    // 把 K 个线性预测 η 原地换成 softmax 概率 p 减去真实类别的独热编码（交叉熵对 η 的梯度），
+    // 返回该样本的交叉熵
+    inline double softmax_residuals(double *eta, std::size_t k, std::size_t label)
+    {
+        const double top = *std::max_element(eta, eta + k);
+        for (std::size_t j = 0; j < k; ++j)
+        {
+            eta[j] -= top;
+        }
+        const double shifted = eta[label];
+        exp_inplace(eta, k);
+        double sum = 0.0;
+        for (std::size_t j = 0; j < k; ++j)
+        {
+            sum += eta[j];
+        }
+        const double inv = 1.0 / sum;
+        for (std::size_t j = 0; j < k; ++j)
+        {
+            eta[j] *= inv;
+        }
+        eta[label] -= 1.0;
+        return std::log(sum) - shifted;
+    }
+
+    // 把运行时的 GlmFamily 转成族策略类型。Softmax 的输出是向量，由调用方单独处理，不经过这里
+    template <typename F>
+    decltype(auto) dispatch_family(GlmFamily family, F &&f)
+    {
+        switch (family)
+        {
+        case GlmFamily::Logistic:
+            return f(Logistic{});
+        case GlmFamily::Poisson:
+            return f(Poisson{});
+        case GlmFamily::Gaussian:
+        default:
+            return f(Gaussian{});
+        }
+    }
+}
+
+#endif // GLM_H
@@ -3,20 +3,112 @@
 
 #include <vector>
 #include <cmath>
+#include <cstdint>
+#include <optional>
 #include <random>
 #include "point.h"
+#include "matrix.h"
+#include "glm.h"
+#include "optimizer.h"
+#include "point_stream.h"
+
+template <typename T>
+class CsrMatrix;
+
+// 并行训练中一个工作线程的统计
+struct WorkerStats
+{
+    // 处理的样本数与累计耗时（秒）
+    std::uint64_t samples = 0;
+    double seconds = 0.0;
+
+    double samples_per_second() const { return seconds > 0.0 ? samples / seconds : 0.0; }
+};
+
+// solve_least_squares 的求解方式
+enum class LeastSquaresSolver
+{
+    Auto,     // 先用 Cholesky；正规矩阵病态时改用 QR，特征维度大到放不下正规矩阵时用 L-BFGS
+    Cholesky, // 一次遍历累加增广 Gram 矩阵（XᵀX、Xᵀy 等），解正规方程
+    QR,       // 一次遍历按行块做分块 Householder QR（TSQR），条件数不被平方，适合病态问题
+    LBFGS     // 不形成正规矩阵，每次函数求值遍历一次数据，适合高维稀疏特征
+};
 
 class GradientDescent
 {
 public:
     GradientDescent(double learning_rate, int max_iterations, double tolerance = 1e-6);
     void batch_gradient_descent(const std::vector<Point> &data);
-    void stochastic_gradient_descent( std::vector<Point> &data);
-    void mini_batch_gradient_descent( std::vector<Point> &data, int batch_size);
+    // SGD 与小批量版本按每个 epoch 重新排列的下标读取样本，不修改也不复制调用方的数据
+    void stochastic_gradient_descent(const std::vector<Point> &data);
+    // 小批量版本按数据并行执行：每个批次切成至多 64 片（每片不少于 16 行），各切片的部分梯度由线程池并行计算，
+    // 再按固定顺序树形归约后做一次参数更新。批大小不小于 32 时开始并行，1024 及以上时切满 64 片。
+    // 切片与归约顺序只取决于批大小，给定种子时结果与线程数无关
+    void mini_batch_gradient_descent(const std::vector<Point> &data, int batch_size);
+    // 稀疏特征上的多元线性回归 y ≈ w·x + b（b 即 intercept_），梯度只在每行的非零元素上累加
+    void batch_gradient_descent(const CsrMatrix<double> &X, const std::vector<double> &y);
+    // 每个样本只更新它非零特征对应的权重，单步代价为 O(nnz)
+    void stochastic_gradient_descent(const CsrMatrix<double> &X, const std::vector<double> &y);
+    // 稠密特征上的多元线性回归 y ≈ X w + b。X 为 n×d 的连续矩阵视图（行优先或列优先；
+    // Eigen 矩阵可以用 data() 和对应的 Layout 构造视图，不需要拷贝）。
+    // 批量版本按缓存大小的行块计算 r = X_b w + b - y_b 与 X_bᵀ r，每个行块读入缓存后被两次矩阵-向量乘复用
+    void batch_gradient_descent(const MatrixView<double> &X, const std::vector<double> &y);
+    void stochastic_gradient_descent(const MatrixView<double> &X, const std::vector<double> &y);
+    void mini_batch_gradient_descent(const MatrixView<double> &X, const std::vector<double> &y, int batch_size);
+    // 在线训练：从流中逐块取出样本，每块到达后按到达顺序做一遍逐样本 SGD，解析与训练在两个线程上重叠进行，
+    // 内存只取决于流的块大小与队列容量。第 k 块（从 0 计）满足 loss_interval 时输出该块在更新前参数下的损失。
+    // 返回处理的样本总数
+    std::size_t online_gradient_descent(PointStream &stream);
+    // 从文件描述符（文件、管道等）读取 "x y" 文本记录在线训练，不关闭 fd
+    std::size_t online_gradient_descent(int fd, const PointStreamOptions &options = PointStreamOptions());
+    // Hogwild 并行 SGD：样本按行号均分为与线程数相同的互不相交分片，每个线程在自己的分片上做 SGD，
+    // 参数以 relaxed 原子读写、不加锁地共享。并发更新偶尔会相互覆盖，稀疏问题上冲突很少，对收敛影响很小；
+    // 结果依赖线程调度，不能逐位复现
+    void hogwild_sgd(const CsrMatrix<double> &X, const std::vector<double> &y);
+    void hogwild_sgd(const MatrixView<double> &X, const std::vector<double> &y);
+    // 直接求解最小二乘 min (1/2n)‖Xw + b - y‖² + (λ/2)‖w‖²（截距不参与正则化），只遍历数据一到几次，
+    // 不依赖学习率。样本按固定的连续分片交给线程池，部分结果按固定顺序归约，结果与线程数无关。
+    // Point 版本的结果写入 slope_ / intercept_；L-BFGS 从当前参数出发，迭代次数与停止阈值沿用 max_iterations / tolerance
+    void solve_least_squares(const std::vector<Point> &data);
+    void solve_least_squares(const CsrMatrix<double> &X, const std::vector<double> &y);
+    void solve_least_squares(const MatrixView<double> &X, const std::vector<double> &y);
+
+    // 打乱样本顺序的粒度：1 表示逐样本的全排列（默认），大于 1 时只打乱 rows 行大小的块并在块内打乱，
+    // 小批量读取的内存更连续
+    void set_shuffle_block(std::size_t rows) { shuffle_block_ = rows; }
+    // 每隔多少轮计算并输出一次损失（默认 10），0 表示训练中从不计算损失。
+    // 批量版本的损失与梯度在同一次遍历中得到，报告的是该轮更新前参数下的损失
+    void set_loss_interval(int every) { loss_interval_ = every; }
+    // 并行训练使用的线程数，0 表示使用全部硬件线程
+    void set_num_threads(int threads) { num_threads_ = threads; }
+    // 打乱样本顺序使用的随机种子；未设置时每次训练从 std::random_device 取种子
+    void set_seed(std::uint64_t seed) { seed_ = seed; }
+    void set_solver(LeastSquaresSolver solver) { solver_ = solver; }
+    // solve_least_squares 的 L2 正则化系数 λ（默认 0），不影响迭代式的梯度下降
+    void set_l2(double lambda) { l2_ = lambda; }
+    // 批量与小批量版本的参数更新方式（默认 SGD，即固定学习率），优化器状态在每次训练开始时清零。
+    // 逐样本的 SGD 与 Hogwild 始终使用固定学习率
+    void set_optimizer(const OptimizerOptions &options) { optimizer_ = options; }
+    // 稀疏 / 稠密矩阵版本拟合的广义线性模型族（默认 Gaussian，即线性回归）。各族共用批量、SGD、小批量与
+    // Hogwild 的调度，只是残差换成 μ(η) - y，报告的损失换成平均负对数似然。Softmax 需要 num_classes >= 2，
+    // y 为 [0, num_classes) 中的类别编号，权重按类别存放为 num_classes×d（类别 c 占 get_weights() 的
+    // [c·d, (c+1)·d)），截距见 get_intercepts()；Softmax 的批量版本与小批量版本一样按切片并行，不支持 Hogwild。
+    // Point 版本（批量、SGD、小批量与在线训练）与 solve_least_squares 只支持 Gaussian
+    void set_family(GlmFamily family, std::size_t num_classes = 0)
+    {
+        family_ = family;
+        num_classes_ = num_classes;
+    }
 
     // 获取训练结果
     double get_slope() const { return slope_; }
     double get_intercept() const { return intercept_; }
+    // 多元版本的特征权重（维度为 X.cols()），只在稀疏 / 稠密矩阵版本训练后有效
+    const std::vector<double> &get_weights() const { return weights_; }
+    // Softmax 各类别的截距
+    const std::vector<double> &get_intercepts() const { return intercepts_; }
+    // 上一次并行训练中每个工作线程处理的样本数与耗时
+    const std::vector<WorkerStats> &get_worker_stats() const { return worker_stats_; }
 
 private:
     double learning_rate_;
@@ -24,8 +116,46 @@ private:
     double tolerance_;
     double slope_;     // 斜率
     double intercept_; // 截距
+    std::vector<double> weights_; // 多元版本的特征权重
+    std::size_t shuffle_block_ = 1;
+    int loss_interval_ = 10;
+    int num_threads_ = 1;
+    std::optional<std::uint64_t> seed_;
+    LeastSquaresSolver solver_ = LeastSquaresSolver::Auto;
+    double l2_ = 0.0;
+    OptimizerOptions optimizer_;
+    std::vector<WorkerStats> worker_stats_;
+    GlmFamily family_ = GlmFamily::Gaussian;
+    std::size_t num_classes_ = 0;
+    std::vector<double> intercepts_; // Softmax 各类别的截距
 
     double compute_loss(const std::vector<Point> &data) const;
-    void update_parameters(const std::vector<Point> &data, double &gradient_slope, double &gradient_intercept);
+    void update_parameters(const std::vector<Point> &data, Optimizer &optimizer, double &gradient_slope,
+                           double &gradient_intercept, double *loss = nullptr);
+    double compute_loss(const CsrMatrix<double> &X, const std::vector<double> &y) const;
+    // Hogwild 的公共调度：每轮每个线程打乱并遍历自己的分片，对每个样本调用 sample(i)；需要时调用 report(iter)
+    template <typename Sample, typename Report>
+    void run_hogwild(std::size_t n, const Sample &sample, const Report &report);
+    // 最小二乘求解的公共流程：Rows 按行提供样本，结果写入 w[0, cols) 与 b
+    template <typename Rows>
+    void solve_rows(const Rows &rows, double *w, double &b);
+    // 本次训练的随机种子
+    std::uint64_t shuffle_seed() const;
+    // 第 iter 轮是否需要计算并输出损失
+    bool report_iteration(int iter) const;
+    double compute_loss(const MatrixView<double> &X, const std::vector<double> &y) const;
+    // 检查多元输入的形状与目标值是否属于当前的族，并在维度变化时把权重和截距重置为 0
+    void prepare_weights(std::size_t rows, std::size_t cols, const std::vector<double> &y);
+    // 只支持 Gaussian 的接口在其他族下抛出 std::invalid_argument
+    void require_gaussian(const char *what) const;
+    // Softmax 的各个调度，Rows 按行提供样本（与最小二乘求解共用）
+    template <typename Rows>
+    double softmax_loss(const Rows &rows) const;
+    template <typename Rows>
+    void softmax_batch(const Rows &rows);
+    template <typename Rows>
+    void softmax_sgd(const Rows &rows);
+    template <typename Rows>
+    void softmax_mini_batch(const Rows &rows, int batch_size);
 };
 #endif // GRADIENT_DESCENT_H
\ No newline at end of file
@@ -0,0 +1,79 @@
+#ifndef IVF_PQ_H
+#define IVF_PQ_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "kmeans.h"
+#include "matrix.h"
+
+// IVF-PQ 索引的配置
+struct IVFPQOptions
+{
+    // 粗量化器的簇数（倒排列表数）
+    int nlist = 1024;
+    // 乘积量化的子空间数，维度必须能被 m 整除；每个向量编码为 m 个字节
+    int m = 8;
+    // 查询时探查的倒排列表数，越大召回越高、越慢
+    int nprobe = 8;
+    // 训练粗量化器和子空间码本时的最大迭代次数
+    int train_iterations = 25;
+    // 训练时使用的 KMeans 配置（线程数、初始化方式、种子等）。度量必须是 Euclidean 或 SquaredEuclidean，
+    // 否则构造时抛出 std::invalid_argument；verbose 被忽略，索引内部的 KMeans 不输出训练过程
+    KMeansOptions kmeans;
+};
+
+// 倒排文件 + 乘积量化的近似最近邻索引（IVFADC）：
+// 粗量化器把向量分到 nlist 个倒排列表，向量相对所属粗中心的残差按 m 个子空间分别量化为 8 位编码。
+// 查询时先找 nprobe 个最近的粗中心，对每个列表构造残差到各码字的距离表，再查表扫描列表中的编码
+class IVFPQIndex
+{
+public:
+    explicit IVFPQIndex(std::size_t dim, const IVFPQOptions &options = IVFPQOptions());
+
+    // 用样本训练粗量化器和子空间码本，之后才能 add / search
+    void train(const MatrixView<float> &data);
+    // 编码并加入索引，ids 为空时使用从当前 size() 开始的连续编号
+    void add(const MatrixView<float> &data, const std::vector<std::int64_t> &ids = {});
+    // 对每个查询返回 k 个近似最近邻（按距离升序），结果为 n×k 的行优先数组；
+    // 距离为近似的平方欧氏距离，不足 k 个时以 id -1 填充。const 且只使用局部缓冲区，可以并发调用
+    void search(const MatrixView<float> &queries, int k, std::vector<std::int64_t> &ids,
+                std::vector<float> &distances) const;
+
+    void set_nprobe(int nprobe) { options_.nprobe = nprobe; }
+    int nprobe() const { return options_.nprobe; }
+    bool is_trained() const { return trained_; }
+    std::size_t size() const { return size_; }
+    std::size_t dim() const { return dim_; }
+
+private:
+    // 每个子空间的码字数（8 位编码）
+    static constexpr std::size_t kCodebookSize = 256;
+
+    // 一个倒排列表：编码按子空间分开存放，codes[s][i] 为第 i 个向量在子空间 s 的编码
+    struct InvertedList
+    {
+        std::vector<std::int64_t> ids;
+        std::vector<AlignedVector<std::uint8_t>> codes;
+    };
+
+    std::size_t dim_;
+    std::size_t dsub_;
+    IVFPQOptions options_;
+    bool trained_ = false;
+    std::size_t size_ = 0;
+    KMeans coarse_;
+    // 每个子空间一个码本量化器，训练后的中心即码字
+    std::vector<KMeans> quantizers_;
+    // 粗中心（nlist×dim）和全部码本（m 个 kCodebookSize×dsub 依次排列）的单精度副本
+    Matrix<float> coarse_centers_;
+    Matrix<float> codebooks_;
+    std::vector<InvertedList> lists_;
+
+    // 计算 data 相对所属粗中心的残差
+    Matrix<float> residuals(const MatrixView<float> &data, const std::vector<int> &assign) const;
+    // 查询残差 r 到全部码字的平方距离表（m×kCodebookSize）
+    void compute_lut(const float *r, float *lut) const;
+};
+
+#endif // IVF_PQ_H
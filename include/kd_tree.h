@@ -0,0 +1,158 @@
+#ifndef KD_TREE_H
+#define KD_TREE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <numeric>
+#include <vector>
+#include "matrix.h"
+
+// 样本上的 KD 树：每个节点对应 indices()[begin, end) 中的样本，缓存其紧包围盒和坐标和。
+// 只保存样本下标，不复制数据；data 在树的生命周期内必须保持有效
+template <typename T>
+class KDTree
+{
+public:
+    struct Node
+    {
+        std::size_t begin;
+        std::size_t end;
+        int left = -1;
+        int right = -1;
+
+        std::size_t count() const { return end - begin; }
+        bool is_leaf() const { return left < 0; }
+    };
+
+    explicit KDTree(const MatrixView<T> &data, std::size_t leaf_size = 32)
+        : data_(data), d_(data.cols()), leaf_size_(std::max<std::size_t>(1, leaf_size))
+    {
+        indices_.resize(data.rows());
+        std::iota(indices_.begin(), indices_.end(), std::size_t(0));
+        if (!indices_.empty())
+        {
+            build(0, indices_.size());
+        }
+    }
+
+    std::size_t dims() const { return d_; }
+    const std::vector<Node> &nodes() const { return nodes_; }
+    const std::vector<std::size_t> &indices() const { return indices_; }
+    const double *lower(int node) const { return lower_.data() + node * d_; }
+    const double *upper(int node) const { return upper_.data() + node * d_; }
+    const double *sum(int node) const { return sum_.data() + node * d_; }
+
+    // 逐层展开根节点，直到子树数不少于 min_tasks 或只剩叶子，返回的子树互不相交且覆盖全部样本。
+    // 结果只依赖树的形状，可以作为确定性的并行任务划分
+    std::vector<int> frontier(std::size_t min_tasks) const
+    {
+        std::vector<int> level;
+        if (nodes_.empty())
+        {
+            return level;
+        }
+        level.push_back(0);
+        while (level.size() < min_tasks)
+        {
+            std::vector<int> next;
+            bool expanded = false;
+            for (int node : level)
+            {
+                if (nodes_[node].is_leaf())
+                {
+                    next.push_back(node);
+                }
+                else
+                {
+                    next.push_back(nodes_[node].left);
+                    next.push_back(nodes_[node].right);
+                    expanded = true;
+                }
+            }
+            if (!expanded)
+            {
+                break;
+            }
+            level = std::move(next);
+        }
+        return level;
+    }
+
+private:
+    MatrixView<T> data_;
+    std::size_t d_;
+    std::size_t leaf_size_;
+    std::vector<std::size_t> indices_;
+    std::vector<Node> nodes_;
+    std::vector<double> lower_;
+    std::vector<double> upper_;
+    std::vector<double> sum_;
+
+    // 构建 [begin, end) 对应的子树，返回节点编号。沿包围盒最宽的维度在中位数处切分
+    int build(std::size_t begin, std::size_t end)
+    {
+        const int node = static_cast<int>(nodes_.size());
+        nodes_.push_back(Node{begin, end});
+        lower_.resize(lower_.size() + d_);
+        upper_.resize(upper_.size() + d_);
+        sum_.resize(sum_.size() + d_, 0.0);
+
+        double *lo = lower_.data() + node * d_;
+        double *hi = upper_.data() + node * d_;
+        for (std::size_t j = 0; j < d_; ++j)
+        {
+            lo[j] = hi[j] = static_cast<double>(data_(indices_[begin], j));
+        }
+        for (std::size_t p = begin; p < end; ++p)
+        {
+            for (std::size_t j = 0; j < d_; ++j)
+            {
+                const double v = static_cast<double>(data_(indices_[p], j));
+                lo[j] = std::min(lo[j], v);
+                hi[j] = std::max(hi[j], v);
+            }
+        }
+
+        std::size_t split_dim = 0;
+        for (std::size_t j = 1; j < d_; ++j)
+        {
+            if (hi[j] - lo[j] > hi[split_dim] - lo[split_dim])
+            {
+                split_dim = j;
+            }
+        }
+        // 样本足够少或全部重合时成为叶子，坐标和直接累加
+        if (end - begin <= leaf_size_ || hi[split_dim] == lo[split_dim])
+        {
+            double *s = sum_.data() + node * d_;
+            for (std::size_t p = begin; p < end; ++p)
+            {
+                for (std::size_t j = 0; j < d_; ++j)
+                {
+                    s[j] += static_cast<double>(data_(indices_[p], j));
+                }
+            }
+            return node;
+        }
+
+        const std::size_t mid = begin + (end - begin) / 2;
+        std::nth_element(indices_.begin() + begin, indices_.begin() + mid, indices_.begin() + end,
+                         [&](std::size_t a, std::size_t b)
+                         { return data_(a, split_dim) < data_(b, split_dim); });
+        const int left = build(begin, mid);
+        const int right = build(mid, end);
+        nodes_[node].left = left;
+        nodes_[node].right = right;
+        // 内部节点的坐标和由两个子节点合并得到（子节点构建时 sum_ 可能重新分配，这里重新取地址）
+        double *s = sum_.data() + node * d_;
+        const double *ls = sum_.data() + left * d_;
+        const double *rs = sum_.data() + right * d_;
+        for (std::size_t j = 0; j < d_; ++j)
+        {
+            s[j] = ls[j] + rs[j];
+        }
+        return node;
+    }
+};
+
+#endif // KD_TREE_H
@@ -5,40 +5,292 @@
 #include <cmath>
 #include <random>
 #include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
 #include "point.h"
+#include "matrix.h"
+
+// 分配步骤使用的算法
+enum class KMeansAlgorithm
+{
+    // 标准 Lloyd：每轮计算全部 n×k 个距离
+    Lloyd,
+    // Elkan：每个点保存 1 个上界和 k 个下界，并利用中心间距离剪枝
+    Elkan,
+    // Hamerly：每个点只保存 1 个上界和 1 个下界，内存开销为 O(n)
+    Hamerly,
+    // Yinyang：把中心分为 t 组，每个点保存 1 个上界和 t 个组下界，同时按组和按中心过滤
+    Yinyang,
+    // KD 树过滤（Kanungo）：对样本建 KD 树，整棵子树只剩一个候选中心时一次性归入，适合低维数据
+    KDTree,
+    // 二分（层次）KMeans：递归地用 2-means 分裂簇得到中心树，分配和预测沿树下降，代价为 O(d·log k)
+    Bisecting
+};
+
+// 初始中心的选取方式
+enum class KMeansInit
+{
+    // 均匀随机选取 k 个不同的样本
+    Random,
+    // k-means++：按到已选中心距离的平方加权依次采样
+    KMeansPlusPlus,
+    // k-means||：每轮并行过采样 oversampling*k 个候选，再对加权候选做 k-means++
+    KMeansParallel
+};
+
+// 距离度量，具体实现见 metric.h 中的策略
+enum class KMeansMetric
+{
+    // 欧氏距离，predict / transform 报告开方后的距离
+    Euclidean,
+    // 平方欧氏距离，分配与欧氏距离相同，报告的距离不开方
+    SquaredEuclidean,
+    // 曼哈顿（L1）距离，中心取逐维中位数（k-medians），仅支持 Lloyd
+    Manhattan,
+    // 余弦距离（球面 KMeans），中心归一化为单位长度，分配化为最大内积，仅支持 Lloyd
+    Cosine
+};
+
+// KMeans 的可选配置
+struct KMeansOptions
+{
+    KMeansAlgorithm algorithm = KMeansAlgorithm::Lloyd;
+    KMeansMetric metric = KMeansMetric::Euclidean;
+    // 分配和更新阶段使用的线程数，0 表示使用全部硬件线程；结果与线程数无关
+    int num_threads = 1;
+    KMeansInit init = KMeansInit::KMeansPlusPlus;
+    // 随机数种子，未设置时使用 std::random_device
+    std::optional<std::uint64_t> seed;
+    // k-means|| 的过采样系数与采样轮数
+    double oversampling = 2.0;
+    int init_rounds = 5;
+    // partial_fit / fit_stream 中每个小批量的样本数
+    std::size_t batch_size = 1024;
+    // 独立重启的次数，多次重启在线程池上并发执行并保留 inertia 最小的结果
+    int n_init = 1;
+    // 是否在收敛时输出迭代次数；多次重启和层次分裂内部的子模型总是静默
+    bool verbose = true;
+    // Yinyang 的中心分组数，0 表示 k/10
+    int yinyang_groups = 0;
+};
+
+// 层次 KMeans 中心树的节点：内部节点有左右两个子节点，叶子对应一个簇
+struct KMeansTreeNode
+{
+    int left = -1;
+    int right = -1;
+    // 叶子对应的簇标签，内部节点为 -1
+    int leaf = -1;
+};
+
+class ThreadPool;
+template <typename T>
+class MappedMatrix;
+template <typename T>
+class CsrMatrix;
 
 class KMeans
 {
 public:
-    // 构造函数，初始化k值和最大迭代次数
-    KMeans(int k, int max_iterations = 100);
-    // 使用数据集进行k-means聚类
+    // 构造函数，初始化k值、最大迭代次数和可选配置
+    KMeans(int k, int max_iterations = 100, const KMeansOptions &options = KMeansOptions());
+    // 使用二维点数据集进行k-means聚类
     void fit(const std::vector<Point> &data);
-    // 获取每个数据点所属的簇标签
+    // 使用 n×d 的连续矩阵（行优先或列优先）进行k-means聚类
+    void fit(const MatrixView<float> &data);
+    void fit(const MatrixView<double> &data);
+    // 带样本权重的聚类（例如在 build_coreset 得到的加权点集上训练）：中心取加权均值，k-means++ 按 w·D(x)^2 采样，
+    // inertia 为加权平方距离之和。不支持 KDTree、Bisecting 和曼哈顿度量
+    void fit(const MatrixView<float> &data, const std::vector<double> &weights);
+    void fit(const MatrixView<double> &data, const std::vector<double> &weights);
+    // 在 CSR 稀疏矩阵上执行 Lloyd 迭代，距离只在非零元素上计算（仅支持 Lloyd，不支持曼哈顿度量）
+    void fit(const CsrMatrix<float> &data);
+    void fit(const CsrMatrix<double> &data);
+    // 在内存映射的二进制矩阵上按块顺序扫描执行 Lloyd 迭代，数据不需要整体读入内存（忽略 algorithm 和 n_init）
+    void fit_mapped(const MappedMatrix<float> &data);
+    void fit_mapped(const MappedMatrix<double> &data);
+    // 小批量在线更新：未训练时先用这批数据初始化中心，之后按 batch_size 切分并以每个中心各自的学习率更新
+    void partial_fit(const MatrixView<float> &data);
+    void partial_fit(const MatrixView<double> &data);
+    // 流式小批量训练：反复调用 next_chunk 取下一块数据（返回 false 表示结束），对每块调用 partial_fit。
+    // 数据块由调用方持有，只需在下一次调用 next_chunk 之前保持有效
+    void fit_stream(const std::function<bool(MatrixView<float> &)> &next_chunk);
+    void fit_stream(const std::function<bool(MatrixView<double> &)> &next_chunk);
+    // 对一批查询点返回最近中心的标签；const 且只使用局部缓冲区，多个线程可以共享同一个训练好的模型并发调用
+    std::vector<int> predict(const MatrixView<float> &data) const;
+    std::vector<int> predict(const MatrixView<double> &data) const;
+    // 稀疏查询点的最近中心标签，总是扫描全部 k 个中心
+    std::vector<int> predict(const CsrMatrix<float> &data) const;
+    std::vector<int> predict(const CsrMatrix<double> &data) const;
+    // 同时返回到最近中心的欧氏距离
+    void predict(const MatrixView<float> &data, std::vector<int> &labels, std::vector<float> &distances) const;
+    void predict(const MatrixView<double> &data, std::vector<int> &labels, std::vector<double> &distances) const;
+    // 返回每个查询点到全部中心的欧氏距离（n×k）
+    Matrix<float> transform(const MatrixView<float> &data) const;
+    Matrix<double> transform(const MatrixView<double> &data) const;
+    // 获取每个数据点所属的簇标签（partial_fit / fit_stream 之后为最后一个小批量的标签）
     const std::vector<int> &get_labels() const { return labels_; }
-    // 获取每个簇的中心点
-    const std::vector<Point> &get_centers() const { return centers_; }
+    // 获取上一次 fit 中借助三角不等式跳过的距离计算次数
+    std::uint64_t get_skipped_distances() const { return skipped_distances_; }
+    // 获取上一次 fit 中每一轮分配跳过的距离计算次数（Elkan / Hamerly / Yinyang，第一轮为完整计算）
+    const std::vector<std::uint64_t> &get_skipped_per_iteration() const { return skipped_per_iteration_; }
+    // 获取上一次 fit 的 inertia：每个样本到所属中心的平方距离之和（曼哈顿 / 余弦度量下为对应距离之和）
+    double get_inertia() const { return inertia_; }
+    // 获取每个簇的中心点（k×d，行优先）
+    const Matrix<double> &get_centers() const { return centers_; }
 
 private:
     // 簇的数量
     int k_;
     // 最大迭代次数
     int max_iterations_;
+    // 可选配置
+    KMeansOptions options_;
     // 存储每个数据点所属的簇标签
     std::vector<int> labels_;
-    // 存储每个簇的中心点
-    std::vector<Point> centers_;
+    // 存储每个簇的中心点，双精度保存以减少累加误差
+    Matrix<double> centers_;
+    // 中心点的单精度副本，float 数据的距离内核直接使用
+    Matrix<float> centers_f_;
+    // 层次模式下的中心树（根节点编号为 0）以及每个节点的中心，非层次模式下为空
+    std::vector<KMeansTreeNode> tree_;
+    Matrix<double> tree_centers_;
+    Matrix<float> tree_centers_f_;
+    // 两种精度下每个中心的 ||c||^2，供 predict / transform 的展开式距离使用
+    std::vector<double> center_norms_;
+    std::vector<float> center_norms_f_;
+    // 每个簇累计分到的样本数，决定小批量更新的学习率；为空表示尚未训练
+    std::vector<double> center_counts_;
+    // 被跳过的距离计算次数
+    std::uint64_t skipped_distances_ = 0;
+    std::vector<std::uint64_t> skipped_per_iteration_;
+    // 上一次 fit 的 inertia
+    double inertia_ = 0.0;
+    // fit 期间使用的线程池，按需创建
+    std::shared_ptr<ThreadPool> pool_;
+    // 初始化等步骤使用的随机数生成器，每次 fit 按 seed 重新设置
+    std::mt19937_64 rng_;
+    // 带权重的 fit 期间指向每个样本的权重，其余时间为 nullptr（等权）
+    const double *sample_weights_ = nullptr;
 
-    // 计算两个点之间的欧氏距离
-    double distance(const Point &a, const Point &b) const;
+    // 返回与数据同精度的中心矩阵
+    template <typename T>
+    const Matrix<T> &working_centers() const;
+    // 返回与数据同精度的中心范数
+    template <typename T>
+    const std::vector<T> &working_norms() const;
+    // 返回（必要时创建）与配置线程数一致的线程池
+    ThreadPool &pool();
+    // 中心更新后同步单精度副本
+    void sync_centers();
+    // fit 的实现，T 为数据的标量类型
+    template <typename T>
+    void fit_impl(const MatrixView<T> &data);
+    template <typename T>
+    void fit_impl(const CsrMatrix<T> &data);
+    template <typename T>
+    void fit_weighted_impl(const MatrixView<T> &data, const std::vector<double> &weights);
     // 初始化簇的中心点
-    void initialize_centers(const std::vector<Point> &data);
+    template <typename T>
+    void initialize_centers(const MatrixView<T> &data);
+    // 三种初始化方式
+    template <typename T>
+    void init_random(const MatrixView<T> &data);
+    template <typename T>
+    void init_plus_plus(const MatrixView<T> &data);
+    template <typename T>
+    void init_parallel(const MatrixView<T> &data);
+    // 稀疏输入的初始化：Random 照常选取，k-means++ 与 k-means|| 都使用 k-means++
+    template <typename T>
+    void initialize_centers(const CsrMatrix<T> &data);
     // 将数据点分配到最近的簇
-    void assign_clusters(const std::vector<Point> &data);
-    // 更新每个簇的中心点
-    void update_centers(const std::vector<Point> &data);
+    template <typename T>
+    void assign_clusters(const MatrixView<T> &data);
+    // 按当前标签确定性地累加每个簇的坐标和与样本数（有样本权重时为加权和与总权重）。
+    // row_scale 非空时第 i 行先乘以 row_scale[i] 再累加（球面 KMeans 传入 1 / ||x_i||），计数不受影响
+    template <typename T>
+    void accumulate_clusters(const MatrixView<T> &data, Matrix<double> &sums, std::vector<double> &counts,
+                             const double *row_scale = nullptr);
+    // 更新每个簇的中心点，row_scale 的含义同 accumulate_clusters
+    template <typename T>
+    void update_centers(const MatrixView<T> &data, const double *row_scale = nullptr);
+    template <typename T>
+    void update_centers(const CsrMatrix<T> &data, const double *row_scale = nullptr);
+    // 对一个小批量做一次分配和按簇学习率的中心更新
+    template <typename T>
+    void minibatch_step(const MatrixView<T> &data);
+    template <typename T>
+    void fit_mapped_impl(const MappedMatrix<T> &data);
+    template <typename T>
+    void partial_fit_impl(const MatrixView<T> &data);
+    template <typename T>
+    void fit_stream_impl(const std::function<bool(MatrixView<T> &)> &next_chunk);
+    // predict / transform 共用的分块内积遍历，以及各自的实现
+    template <typename T, typename F>
+    void for_each_dot_block(const MatrixView<T> &data, F &&fn) const;
+    template <typename T>
+    void predict_impl(const MatrixView<T> &data, std::vector<int> &labels, std::vector<T> *distances) const;
+    // 检查查询矩阵的维度以及模型是否已训练
+    void check_query(std::size_t cols) const;
+    // 按度量策略 M 扫描全部中心，labels 须有 data.rows() 个元素
+    template <typename T, typename M>
+    void predict_flat(const MatrixView<T> &data, int *labels) const;
+    template <typename T>
+    Matrix<T> transform_impl(const MatrixView<T> &data) const;
+    // 稀疏输入：对 [begin, end) 行按度量策略 M 求最近中心，写入 labels[0, end - begin)
+    template <typename T, typename M>
+    void predict_sparse(const CsrMatrix<T> &data, std::size_t begin, std::size_t end, int *labels) const;
+    template <typename T>
+    std::vector<int> predict_sparse_impl(const CsrMatrix<T> &data) const;
+    template <typename T, typename M>
+    void run_lloyd_sparse(const CsrMatrix<T> &data);
+    template <typename T, typename M>
+    double sparse_inertia(const CsrMatrix<T> &data);
+    // 按当前标签计算 inertia
+    template <typename T>
+    double compute_inertia(const MatrixView<T> &data);
+    // 非欧氏度量下的 inertia、Lloyd 主循环、逐维中位数更新与中心归一化
+    template <typename T, typename M>
+    double metric_inertia(const MatrixView<T> &data);
+    template <typename T, typename M>
+    void run_lloyd_metric(const MatrixView<T> &data);
+    template <typename T>
+    void update_medians(const MatrixView<T> &data);
+    void normalize_centers();
+    // 配置的度量是否为欧氏或平方欧氏
+    bool euclidean_metric() const;
+    // n_init > 1 时并发执行多次重启并保留最优结果
+    template <typename Data>
+    void fit_restarts(const Data &data);
+    // 各分配算法的迭代主循环
+    template <typename T>
+    void run_lloyd(const MatrixView<T> &data);
+    template <typename T>
+    void run_elkan(const MatrixView<T> &data);
+    template <typename T>
+    void run_hamerly(const MatrixView<T> &data);
+    template <typename T>
+    void run_yinyang(const MatrixView<T> &data);
+    template <typename T>
+    void run_kdtree(const MatrixView<T> &data);
+    // 累计一轮分配中跳过的距离计算次数
+    void record_skipped(std::uint64_t skipped);
+    // 层次模式：逐层并行分裂构建中心树
+    template <typename T>
+    void run_bisecting(const MatrixView<T> &data);
+    template <typename T>
+    const Matrix<T> &working_tree_centers() const;
+    // 第 i 个样本沿中心树下降到的叶子标签
+    template <typename T>
+    int descend_tree(const MatrixView<T> &data, std::size_t i) const;
+    // 计算中心两两之间的距离（k×k）以及每个中心到最近其他中心距离的一半
+    void center_separation(Matrix<double> &center_dist, std::vector<double> &half_min) const;
+    // 计算每个中心相对 old_centers 的移动距离
+    std::vector<double> center_shifts(const Matrix<double> &old_centers) const;
     // 检查算法是否收敛
-    bool has_converged(const std::vector<Point> &old_centers) const;
+    bool has_converged(const Matrix<double> &old_centers) const;
 };
 
-#endif // KMEANS_H
\ No newline at end of file
+#endif // KMEANS_H
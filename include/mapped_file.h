@@ -0,0 +1,97 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include "matrix.h"
+
+// 只读内存映射文件。页面由操作系统按需调入，数据集可以远大于物理内存
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    // 映射整个文件，失败时抛出 std::runtime_error
+    explicit MappedFile(const std::string &path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile &operator=(MappedFile &&other) noexcept;
+
+    const char *data() const { return data_; }
+    std::size_t size() const { return size_; }
+
+    // 提示内核整个映射将被顺序访问，可以加大预读
+    void advise_sequential() const;
+    // 提示内核 [offset, offset + length) 即将被访问，提前异步读入
+    void advise_willneed(std::size_t offset, std::size_t length) const;
+    // 提示内核 [offset, offset + length) 暂时不再需要，可以回收对应页面
+    void advise_dontneed(std::size_t offset, std::size_t length) const;
+
+private:
+    const char *data_ = nullptr;
+    std::size_t size_ = 0;
+#ifdef _WIN32
+    void *file_ = nullptr;
+    void *mapping_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+
+    void close();
+};
+
+// 内存映射的 n×d 行优先二进制矩阵：文件从 header_bytes 处开始连续存放 T 类型的元素，不含其他元数据
+template <typename T>
+class MappedMatrix
+{
+public:
+    MappedMatrix(const std::string &path, std::size_t cols, std::size_t header_bytes = 0)
+        : file_(path), cols_(cols), offset_(header_bytes)
+    {
+        if (cols_ == 0)
+        {
+            throw std::invalid_argument("MappedMatrix: cols must be positive");
+        }
+        if (offset_ % alignof(T) != 0)
+        {
+            throw std::invalid_argument("MappedMatrix: header_bytes must keep elements aligned");
+        }
+        if (file_.size() < offset_ || (file_.size() - offset_) % (cols_ * sizeof(T)) != 0)
+        {
+            throw std::runtime_error("MappedMatrix: file size is not a multiple of the row size: " + path);
+        }
+        rows_ = (file_.size() - offset_) / (cols_ * sizeof(T));
+    }
+
+    std::size_t rows() const { return rows_; }
+    std::size_t cols() const { return cols_; }
+    std::size_t row_bytes() const { return cols_ * sizeof(T); }
+    const MappedFile &file() const { return file_; }
+
+    // 整个文件的矩阵视图，访问到的页面才会真正读入
+    MatrixView<T> view() const
+    {
+        return MatrixView<T>(reinterpret_cast<const T *>(file_.data() + offset_), rows_, cols_);
+    }
+
+    // 按行区间发出预读 / 回收提示
+    void prefetch_rows(std::size_t begin, std::size_t end) const
+    {
+        file_.advise_willneed(offset_ + begin * row_bytes(), (end - begin) * row_bytes());
+    }
+    void release_rows(std::size_t begin, std::size_t end) const
+    {
+        file_.advise_dontneed(offset_ + begin * row_bytes(), (end - begin) * row_bytes());
+    }
+
+private:
+    MappedFile file_;
+    std::size_t cols_;
+    std::size_t offset_;
+    std::size_t rows_ = 0;
+};
+
+#endif // MAPPED_FILE_H
@@ -0,0 +1,143 @@
+#ifndef MATRIX_H
+#define MATRIX_H
+
+#include <cstddef>
+#include <new>
+#include <stdexcept>
+#include <vector>
+#include "point.h"
+
+// 矩阵缓冲区的对齐字节数（一条缓存行，同时满足 AVX-512 的对齐要求）
+constexpr std::size_t kMatrixAlignment = 64;
+
+// 按 kMatrixAlignment 对齐分配内存的分配器，供 std::vector 使用
+template <typename T>
+struct AlignedAllocator
+{
+    using value_type = T;
+
+    AlignedAllocator() noexcept = default;
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U> &) noexcept {}
+
+    T *allocate(std::size_t n)
+    {
+        return static_cast<T *>(::operator new(n * sizeof(T), std::align_val_t(kMatrixAlignment)));
+    }
+    void deallocate(T *p, std::size_t) noexcept
+    {
+        ::operator delete(p, std::align_val_t(kMatrixAlignment));
+    }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U> &) const noexcept { return true; }
+    template <typename U>
+    bool operator!=(const AlignedAllocator<U> &) const noexcept { return false; }
+};
+
+template <typename T>
+using AlignedVector = std::vector<T, AlignedAllocator<T>>;
+
+// 矩阵的存储顺序：行优先（每个样本连续）或列优先（每个特征连续，即 SoA）
+enum class Layout
+{
+    RowMajor,
+    ColMajor
+};
+
+// 不持有数据的只读矩阵视图，rows 为样本数，cols 为特征维度
+// ld 为主维步长：行优先时是相邻两行的间隔，列优先时是相邻两列的间隔
+template <typename T>
+class MatrixView
+{
+public:
+    MatrixView() = default;
+    MatrixView(const T *data, std::size_t rows, std::size_t cols,
+               Layout layout = Layout::RowMajor, std::size_t ld = 0)
+        : data_(data), rows_(rows), cols_(cols), layout_(layout),
+          ld_(ld != 0 ? ld : (layout == Layout::RowMajor ? cols : rows))
+    {
+    }
+
+    const T *data() const { return data_; }
+    std::size_t rows() const { return rows_; }
+    std::size_t cols() const { return cols_; }
+    Layout layout() const { return layout_; }
+    std::size_t ld() const { return ld_; }
+    bool row_major() const { return layout_ == Layout::RowMajor; }
+    bool empty() const { return rows_ == 0 || cols_ == 0; }
+
+    T operator()(std::size_t i, std::size_t j) const
+    {
+        return layout_ == Layout::RowMajor ? data_[i * ld_ + j] : data_[j * ld_ + i];
+    }
+    // 第 i 行的首地址，仅在行优先时连续
+    const T *row(std::size_t i) const { return data_ + i * ld_; }
+    // 第 j 列的首地址，仅在列优先时连续
+    const T *col(std::size_t j) const { return data_ + j * ld_; }
+
+    // 取 [begin, end) 行组成的子视图，两种存储顺序都不需要拷贝
+    MatrixView row_block(std::size_t begin, std::size_t end) const
+    {
+        const T *start = layout_ == Layout::RowMajor ? data_ + begin * ld_ : data_ + begin;
+        return MatrixView(start, end - begin, cols_, layout_, ld_);
+    }
+
+private:
+    const T *data_ = nullptr;
+    std::size_t rows_ = 0;
+    std::size_t cols_ = 0;
+    Layout layout_ = Layout::RowMajor;
+    std::size_t ld_ = 0;
+};
+
+// 持有数据的连续、对齐的行优先矩阵
+template <typename T>
+class Matrix
+{
+public:
+    Matrix() = default;
+    Matrix(std::size_t rows, std::size_t cols, T value = T())
+        : rows_(rows), cols_(cols), data_(rows * cols, value)
+    {
+    }
+
+    std::size_t rows() const { return rows_; }
+    std::size_t cols() const { return cols_; }
+    bool empty() const { return data_.empty(); }
+    T *data() { return data_.data(); }
+    const T *data() const { return data_.data(); }
+    T *row(std::size_t i) { return data_.data() + i * cols_; }
+    const T *row(std::size_t i) const { return data_.data() + i * cols_; }
+    T &operator()(std::size_t i, std::size_t j) { return data_[i * cols_ + j]; }
+    T operator()(std::size_t i, std::size_t j) const { return data_[i * cols_ + j]; }
+
+    void resize(std::size_t rows, std::size_t cols, T value = T())
+    {
+        rows_ = rows;
+        cols_ = cols;
+        data_.assign(rows * cols, value);
+    }
+
+    MatrixView<T> view() const { return MatrixView<T>(data_.data(), rows_, cols_); }
+    operator MatrixView<T>() const { return view(); }
+
+    // 把二维 Point 数组转换为 n×2 的矩阵
+    static Matrix from_points(const std::vector<Point> &points)
+    {
+        Matrix m(points.size(), 2);
+        for (std::size_t i = 0; i < points.size(); ++i)
+        {
+            m(i, 0) = static_cast<T>(points[i].x);
+            m(i, 1) = static_cast<T>(points[i].y);
+        }
+        return m;
+    }
+
+private:
+    std::size_t rows_ = 0;
+    std::size_t cols_ = 0;
+    AlignedVector<T> data_;
+};
+
+#endif // MATRIX_H
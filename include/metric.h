@@ -0,0 +1,78 @@
+#ifndef METRIC_H
+#define METRIC_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include "distance.h"
+
+// KMeans 的距离度量策略。每个策略在编译期确定分配时比较的分数、对应的中心更新方式以及报告给调用方的距离，
+// 分配循环按策略实例化，内层循环中没有运行时分支
+namespace metric
+{
+    // 中心的更新方式
+    enum class Update
+    {
+        // 簇内均值
+        Mean,
+        // 簇内样本先各自单位化为 x / ||x||，取均值后再归一化到单位长度（球面 KMeans）。
+        // 这样更新与余弦距离只看方向的分配目标一致，长度较大的样本不会主导中心的方向
+        NormalizedMean,
+        // 逐维中位数（k-medians，使 L1 距离之和最小）
+        Median
+    };
+
+    // 平方欧氏距离：分配和报告的距离都不开方
+    struct SquaredEuclidean
+    {
+        // 分数可以由 ||x||^2 - 2 x·c + ||c||^2 得到，分配可以走分块内积
+        static constexpr bool kViaDot = true;
+        static constexpr Update kUpdate = Update::Mean;
+
+        template <typename T>
+        static T score(const T *x, const T *c, std::size_t d) { return simd::squared_l2(x, c, d); }
+        template <typename T>
+        static T score_from_dot(T x_norm, T dot, T c_norm) { return x_norm - 2 * dot + c_norm; }
+        // 分数换算为距离，x_norm 为 ||x||^2
+        template <typename T>
+        static T distance(T score, T) { return std::max(T(0), score); }
+    };
+
+    // 欧氏距离：与平方欧氏距离的分配完全相同，只在报告距离时开方
+    struct Euclidean : SquaredEuclidean
+    {
+        template <typename T>
+        static T distance(T score, T) { return std::sqrt(std::max(T(0), score)); }
+    };
+
+    // 曼哈顿（L1）距离，中心取逐维中位数
+    struct Manhattan
+    {
+        static constexpr bool kViaDot = false;
+        static constexpr Update kUpdate = Update::Median;
+
+        template <typename T>
+        static T score(const T *x, const T *c, std::size_t d) { return simd::l1(x, c, d); }
+        template <typename T>
+        static T score_from_dot(T, T, T) { return T(0); }
+        template <typename T>
+        static T distance(T score, T) { return score; }
+    };
+
+    // 余弦距离 1 - x·c / (||x|| ||c||)。中心保持单位长度，分配化为与中心的最大内积，可以走分块内积；
+    // 输入不必是单位向量，中心更新按 NormalizedMean 累加 x / ||x||
+    struct Cosine
+    {
+        static constexpr bool kViaDot = true;
+        static constexpr Update kUpdate = Update::NormalizedMean;
+
+        template <typename T>
+        static T score(const T *x, const T *c, std::size_t d) { return -simd::dot(x, c, d); }
+        template <typename T>
+        static T score_from_dot(T, T dot, T) { return -dot; }
+        template <typename T>
+        static T distance(T score, T x_norm) { return x_norm > T(0) ? T(1) + score / std::sqrt(x_norm) : T(1); }
+    };
+}
+
+#endif // METRIC_H
@@ -0,0 +1,298 @@
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+#include "distance.h"
+
+// 梯度下降的参数更新方式
+enum class OptimizerKind
+{
+    SGD,      // 固定学习率
+    Momentum, // 重球动量
+    Nesterov, // Nesterov 动量
+    AdaGrad,
+    RMSProp,
+    Adam
+};
+
+struct OptimizerOptions
+{
+    OptimizerKind kind = OptimizerKind::SGD;
+    // Momentum / Nesterov 的动量系数
+    double momentum = 0.9;
+    // RMSProp 梯度平方滑动平均的衰减率
+    double decay = 0.9;
+    // Adam 一阶、二阶矩的衰减率
+    double beta1 = 0.9;
+    double beta2 = 0.999;
+    // AdaGrad / RMSProp / Adam 分母中防止除零的小量
+    double epsilon = 1e-8;
+};
+
+// 优化器策略。每个策略用一份模板公式描述单个参数的更新，分别以 double 和 AVX 的 4 路 double 实例化；
+// fused_update 在一次循环中读入参数、梯度与状态，更新后写回，循环体内没有运行时分支
+namespace optim
+{
+    // 一步更新用到的系数，由 Optimizer 每步计算一次
+    template <typename V>
+    struct Coefficients
+    {
+        V learning_rate;
+        V momentum;
+        V decay, one_minus_decay;
+        V beta1, one_minus_beta1;
+        V beta2, one_minus_beta2;
+        // Adam 含偏差修正的步长与 epsilon
+        V adam_step, adam_epsilon;
+        V epsilon;
+    };
+
+    inline double add(double a, double b) { return a + b; }
+    inline double sub(double a, double b) { return a - b; }
+    inline double mul(double a, double b) { return a * b; }
+    inline double div(double a, double b) { return a / b; }
+    inline double root(double a) { return std::sqrt(a); }
+    inline double fmadd(double a, double b, double c) { return a * b + c; }
+
+#if defined(__AVX__)
+    // 4 路 double。包一层结构体，避免把带对齐属性的 __m256d 直接用作模板实参
+    struct Pack
+    {
+        __m256d v;
+    };
+
+    inline Pack add(Pack a, Pack b) { return {_mm256_add_pd(a.v, b.v)}; }
+    inline Pack sub(Pack a, Pack b) { return {_mm256_sub_pd(a.v, b.v)}; }
+    inline Pack mul(Pack a, Pack b) { return {_mm256_mul_pd(a.v, b.v)}; }
+    inline Pack div(Pack a, Pack b) { return {_mm256_div_pd(a.v, b.v)}; }
+    inline Pack root(Pack a) { return {_mm256_sqrt_pd(a.v)}; }
+    inline Pack fmadd(Pack a, Pack b, Pack c) { return {ML_SIMD_FMADD_PD(a.v, b.v, c.v)}; }
+
+    inline Coefficients<Pack> broadcast(const Coefficients<double> &c)
+    {
+        auto set = [](double x)
+        { return Pack{_mm256_set1_pd(x)}; };
+        return {set(c.learning_rate), set(c.momentum),
+                set(c.decay), set(c.one_minus_decay),
+                set(c.beta1), set(c.one_minus_beta1),
+                set(c.beta2), set(c.one_minus_beta2),
+                set(c.adam_step), set(c.adam_epsilon),
+                set(c.epsilon)};
+    }
+#endif
+
+    // w -= lr·g
+    struct SGD
+    {
+        static constexpr int kStates = 0;
+
+        template <typename V>
+        static void apply(V &w, V g, V &, V &, const Coefficients<V> &c) { w = sub(w, mul(c.learning_rate, g)); }
+    };
+
+    // v = μv + g，w -= lr·v
+    struct Momentum
+    {
+        static constexpr int kStates = 1;
+
+        template <typename V>
+        static void apply(V &w, V g, V &v, V &, const Coefficients<V> &c)
+        {
+            v = fmadd(c.momentum, v, g);
+            w = sub(w, mul(c.learning_rate, v));
+        }
+    };
+
+    // v = μv + g，w -= lr·(g + μv)：沿动量方向前瞻一步后的梯度
+    struct Nesterov
+    {
+        static constexpr int kStates = 1;
+
+        template <typename V>
+        static void apply(V &w, V g, V &v, V &, const Coefficients<V> &c)
+        {
+            v = fmadd(c.momentum, v, g);
+            w = sub(w, mul(c.learning_rate, fmadd(c.momentum, v, g)));
+        }
+    };
+
+    // s += g²，w -= lr·g / (√s + ε)
+    struct AdaGrad
+    {
+        static constexpr int kStates = 1;
+
+        template <typename V>
+        static void apply(V &w, V g, V &s, V &, const Coefficients<V> &c)
+        {
+            s = fmadd(g, g, s);
+            w = sub(w, div(mul(c.learning_rate, g), add(root(s), c.epsilon)));
+        }
+    };
+
+    // s = ρs + (1 - ρ)g²，w -= lr·g / (√s + ε)
+    struct RMSProp
+    {
+        static constexpr int kStates = 1;
+
+        template <typename V>
+        static void apply(V &w, V g, V &s, V &, const Coefficients<V> &c)
+        {
+            s = fmadd(c.decay, s, mul(c.one_minus_decay, mul(g, g)));
+            w = sub(w, div(mul(c.learning_rate, g), add(root(s), c.epsilon)));
+        }
+    };
+
+    // m = β1·m + (1 - β1)g，v = β2·v + (1 - β2)g²，w -= α_t·m / (√v + ε_t)。
+    // 偏差修正折算进每步的 α_t 与 ε_t，与逐元素修正 m、v 的写法等价
+    struct Adam
+    {
+        static constexpr int kStates = 2;
+
+        template <typename V>
+        static void apply(V &w, V g, V &m, V &v, const Coefficients<V> &c)
+        {
+            m = fmadd(c.beta1, m, mul(c.one_minus_beta1, g));
+            v = fmadd(c.beta2, v, mul(c.one_minus_beta2, mul(g, g)));
+            w = sub(w, div(mul(c.adam_step, m), add(root(v), c.adam_epsilon)));
+        }
+    };
+
+    // w[0, n) 按策略 Policy 更新一步，s0 / s1 为策略用到的状态（未用到的可以为空）
+    template <typename Policy>
+    inline void fused_update(double *w, const double *g, double *s0, double *s1, std::size_t n,
+                             const Coefficients<double> &c)
+    {
+        std::size_t j = 0;
+#if defined(__AVX__)
+        const Coefficients<Pack> vc = broadcast(c);
+        for (; j + 4 <= n; j += 4)
+        {
+            Pack vw{_mm256_loadu_pd(w + j)};
+            Pack v0{_mm256_setzero_pd()};
+            Pack v1{_mm256_setzero_pd()};
+            if constexpr (Policy::kStates >= 1)
+            {
+                v0.v = _mm256_loadu_pd(s0 + j);
+            }
+            if constexpr (Policy::kStates >= 2)
+            {
+                v1.v = _mm256_loadu_pd(s1 + j);
+            }
+            Policy::apply(vw, Pack{_mm256_loadu_pd(g + j)}, v0, v1, vc);
+            _mm256_storeu_pd(w + j, vw.v);
+            if constexpr (Policy::kStates >= 1)
+            {
+                _mm256_storeu_pd(s0 + j, v0.v);
+            }
+            if constexpr (Policy::kStates >= 2)
+            {
+                _mm256_storeu_pd(s1 + j, v1.v);
+            }
+        }
+#endif
+        for (; j < n; ++j)
+        {
+            double v0 = 0.0;
+            double v1 = 0.0;
+            if constexpr (Policy::kStates >= 1)
+            {
+                v0 = s0[j];
+            }
+            if constexpr (Policy::kStates >= 2)
+            {
+                v1 = s1[j];
+            }
+            Policy::apply(w[j], g[j], v0, v1, c);
+            if constexpr (Policy::kStates >= 1)
+            {
+                s0[j] = v0;
+            }
+            if constexpr (Policy::kStates >= 2)
+            {
+                s1[j] = v1;
+            }
+        }
+    }
+
+    // 把运行时的 OptimizerKind 转成策略类型，f 以策略的默认构造对象调用
+    template <typename F>
+    decltype(auto) dispatch_optimizer(OptimizerKind kind, F &&f)
+    {
+        switch (kind)
+        {
+        case OptimizerKind::Momentum:
+            return f(Momentum{});
+        case OptimizerKind::Nesterov:
+            return f(Nesterov{});
+        case OptimizerKind::AdaGrad:
+            return f(AdaGrad{});
+        case OptimizerKind::RMSProp:
+            return f(RMSProp{});
+        case OptimizerKind::Adam:
+            return f(Adam{});
+        case OptimizerKind::SGD:
+        default:
+            return f(SGD{});
+        }
+    }
+}
+
+// d 个权重加一个截距的优化器状态，状态的最后一个元素对应截距。
+// 每次 step 先计算该步的系数，再按所选策略对权重和截距各执行一次融合更新
+class Optimizer
+{
+public:
+    Optimizer(const OptimizerOptions &options, double learning_rate, std::size_t d)
+        : options_(options), learning_rate_(learning_rate), d_(d)
+    {
+        auto unit = [](double x)
+        { return x >= 0.0 && x < 1.0; };
+        if (!unit(options.momentum) || !unit(options.decay) || !unit(options.beta1) || !unit(options.beta2))
+        {
+            throw std::invalid_argument("Optimizer: momentum, decay and beta must lie in [0, 1)");
+        }
+        if (!(options.epsilon > 0.0))
+        {
+            throw std::invalid_argument("Optimizer: epsilon must be positive");
+        }
+        const int states = optim::dispatch_optimizer(options.kind, [](auto policy)
+                                                     { return decltype(policy)::kStates; });
+        state0_.assign(states >= 1 ? d + 1 : 0, 0.0);
+        state1_.assign(states >= 2 ? d + 1 : 0, 0.0);
+    }
+
+    // w[0, d) 与 b 沿梯度 gw、gb 更新一步
+    void step(double *w, const double *gw, double &b, double gb)
+    {
+        ++steps_;
+        const double t = static_cast<double>(steps_);
+        const double bias2 = std::sqrt(1.0 - std::pow(options_.beta2, t));
+        const optim::Coefficients<double> c{learning_rate_, options_.momentum,
+                                            options_.decay, 1.0 - options_.decay,
+                                            options_.beta1, 1.0 - options_.beta1,
+                                            options_.beta2, 1.0 - options_.beta2,
+                                            learning_rate_ * bias2 / (1.0 - std::pow(options_.beta1, t)),
+                                            options_.epsilon * bias2,
+                                            options_.epsilon};
+        double *s0 = state0_.empty() ? nullptr : state0_.data();
+        double *s1 = state1_.empty() ? nullptr : state1_.data();
+        optim::dispatch_optimizer(options_.kind, [&](auto policy)
+                                  {
+            using Policy = decltype(policy);
+            optim::fused_update<Policy>(w, gw, s0, s1, d_, c);
+            optim::fused_update<Policy>(&b, &gb, s0 ? s0 + d_ : nullptr, s1 ? s1 + d_ : nullptr, 1, c); });
+    }
+
+private:
+    OptimizerOptions options_;
+    double learning_rate_;
+    std::size_t d_;
+    std::size_t steps_ = 0;
+    std::vector<double> state0_;
+    std::vector<double> state1_;
+};
+
+#endif // OPTIMIZER_H
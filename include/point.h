@@ -1,6 +1,8 @@
 #ifndef POINT_H
 #define POINT_H
 
+#include <utility>
+
 struct Point
 {
     double x; // 特征值
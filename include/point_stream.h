@@ -0,0 +1,81 @@
+#ifndef POINT_STREAM_H
+#define POINT_STREAM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "point.h"
+
+// 解析一行 "x y" 文本记录（[begin, end) 不含换行符），两个数之间以空格或制表符分隔，其后的内容被忽略。
+// 每个数可以带一个前导 '+'。不能解析出两个数时返回 false
+bool parse_point_line(const char *begin, const char *end, Point &point);
+
+// 把整个 "x y" 文本文件读入一块连续的内存。文件被内存映射后按窗口处理：窗口按换行符切成若干块，
+// 线程池先并行统计每块的行数，前缀和给出每块在结果中的起始位置，再并行用 from_chars 解析并直接写入
+// 预先分配好的位置。每个窗口只从磁盘读入一次，下一个窗口提前预读，已处理的窗口交还给内核。
+// 无法解析的行被跳过，skipped_lines 非空时写入跳过的行数；空行直接忽略。num_threads 为 0 时使用全部硬件线程。
+// 文件无法打开或映射时抛出 std::runtime_error
+std::vector<Point> load_points(const std::string &path, int num_threads = 0, std::size_t *skipped_lines = nullptr);
+
+struct PointStreamOptions
+{
+    // 每块的最大点数
+    std::size_t chunk_points = 65536;
+    // 第一块的点数，之后每块翻倍直到 chunk_points：流刚开始时让训练尽早拿到第一批样本
+    std::size_t first_chunk_points = 256;
+    // 队列中最多缓存的块数，解析线程在队列满时等待
+    std::size_t queue_chunks = 4;
+    // 每次 read() 的字节数
+    std::size_t read_bytes = std::size_t(1) << 20;
+};
+
+// 从文件描述符（普通文件、管道、套接字）按块读取 "x y" 文本记录的流。
+// 后台线程负责 read() 与解析，解析好的块放入容量固定的队列，消费者用 next() 逐块取出；
+// 块缓冲区在两个线程之间循环复用，内存占用只取决于块大小与队列容量，与流的长度无关。
+// 无法解析的行被跳过并计数，空行直接忽略
+class PointStream
+{
+public:
+    // 不接管 fd 的所有权，析构时不关闭
+    explicit PointStream(int fd, const PointStreamOptions &options = PointStreamOptions());
+    ~PointStream();
+
+    PointStream(const PointStream &) = delete;
+    PointStream &operator=(const PointStream &) = delete;
+
+    // 取出下一块样本放入 chunk，chunk 原有的缓冲区交还给解析线程复用。
+    // 流结束且没有剩余的块时返回 false；读取失败时在已解析的块取完之后抛出 std::runtime_error
+    bool next(std::vector<Point> &chunk);
+    // 目前为止跳过的无法解析的行数
+    std::size_t skipped_lines() const { return skipped_.load(std::memory_order_relaxed); }
+
+private:
+    int fd_;
+    PointStreamOptions options_;
+    std::mutex mutex_;
+    std::condition_variable ready_cv_; // 队列非空或流已结束
+    std::condition_variable space_cv_; // 队列有空位或要求停止
+    std::deque<std::vector<Point>> queue_;
+    std::vector<std::vector<Point>> free_;
+    bool done_ = false;
+    bool stop_ = false;
+    std::exception_ptr error_;
+    std::atomic<std::size_t> skipped_{0};
+    std::thread parser_;
+
+    void parse_loop();
+    // 把 chunk 放入队列，队列满时等待；要求停止时返回 false
+    bool push(std::vector<Point> &chunk);
+    // 从回收的缓冲区中取一个空块，没有时新建
+    std::vector<Point> take_buffer();
+    // 等待 fd 可读，要求停止时返回 false
+    bool wait_readable();
+};
+
+#endif // POINT_STREAM_H
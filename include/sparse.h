@@ -0,0 +1,89 @@
+#ifndef SPARSE_H
+#define SPARSE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "matrix.h"
+
+// 压缩稀疏行（CSR）矩阵：第 i 行的非零元素为 indices / values 的 [indptr[i], indptr[i + 1]) 段，
+// 行内列号严格递增。rows 为样本数，cols 为特征维度，只保存非零元素
+template <typename T>
+class CsrMatrix
+{
+public:
+    CsrMatrix() : indptr_(1, 0) {}
+    // 直接接管三个数组，检查结构是否合法，不合法时抛出 std::invalid_argument
+    CsrMatrix(std::size_t rows, std::size_t cols, std::vector<std::size_t> indptr,
+              std::vector<std::uint32_t> indices, std::vector<T> values)
+        : rows_(rows), cols_(cols), indptr_(std::move(indptr)), indices_(std::move(indices)),
+          values_(std::move(values))
+    {
+        if (indptr_.size() != rows_ + 1 || indptr_.front() != 0 || indptr_.back() != indices_.size() ||
+            indices_.size() != values_.size())
+        {
+            throw std::invalid_argument("CsrMatrix: inconsistent indptr / indices / values sizes");
+        }
+        for (std::size_t i = 0; i < rows_; ++i)
+        {
+            if (indptr_[i] > indptr_[i + 1])
+            {
+                throw std::invalid_argument("CsrMatrix: indptr must be non-decreasing");
+            }
+            for (std::size_t p = indptr_[i]; p < indptr_[i + 1]; ++p)
+            {
+                if (indices_[p] >= cols_ || (p > indptr_[i] && indices_[p] <= indices_[p - 1]))
+                {
+                    throw std::invalid_argument("CsrMatrix: column indices must be in range and strictly increasing");
+                }
+            }
+        }
+    }
+
+    // 从稠密矩阵构造，只保留非零元素
+    static CsrMatrix from_dense(const MatrixView<T> &dense)
+    {
+        std::vector<std::size_t> indptr(dense.rows() + 1, 0);
+        std::vector<std::uint32_t> indices;
+        std::vector<T> values;
+        for (std::size_t i = 0; i < dense.rows(); ++i)
+        {
+            for (std::size_t j = 0; j < dense.cols(); ++j)
+            {
+                const T v = dense(i, j);
+                if (v != T(0))
+                {
+                    indices.push_back(static_cast<std::uint32_t>(j));
+                    values.push_back(v);
+                }
+            }
+            indptr[i + 1] = indices.size();
+        }
+        return CsrMatrix(dense.rows(), dense.cols(), std::move(indptr), std::move(indices), std::move(values));
+    }
+
+    std::size_t rows() const { return rows_; }
+    std::size_t cols() const { return cols_; }
+    std::size_t nnz() const { return values_.size(); }
+    bool empty() const { return rows_ == 0 || cols_ == 0; }
+
+    // 第 i 行的非零元素个数、列号和取值
+    std::size_t row_nnz(std::size_t i) const { return indptr_[i + 1] - indptr_[i]; }
+    const std::uint32_t *row_indices(std::size_t i) const { return indices_.data() + indptr_[i]; }
+    const T *row_values(std::size_t i) const { return values_.data() + indptr_[i]; }
+
+    const std::vector<std::size_t> &indptr() const { return indptr_; }
+    const std::vector<std::uint32_t> &indices() const { return indices_; }
+    const std::vector<T> &values() const { return values_; }
+
+private:
+    std::size_t rows_ = 0;
+    std::size_t cols_ = 0;
+    std::vector<std::size_t> indptr_;
+    std::vector<std::uint32_t> indices_;
+    std::vector<T> values_;
+};
+
+#endif // SPARSE_H
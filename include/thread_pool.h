@@ -0,0 +1,91 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// 固定大小的线程池，提供阻塞式的 parallel_for。
+// 调用线程本身也参与执行任务；在任务内部对同一个线程池再次调用 parallel_for 时会退化为串行执行，避免死锁
+class ThreadPool
+{
+public:
+    // num_threads 为参与计算的线程总数（包含调用线程），0 表示使用全部硬件线程
+    explicit ThreadPool(int num_threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // 参与计算的线程总数
+    int size() const { return static_cast<int>(workers_.size()) + 1; }
+    // 对 [0, n_tasks) 中的每个任务调用一次 fn(task)，全部完成后返回；任务中的第一个异常会在调用线程重新抛出。
+    // fn 只以引用的形式交给工作线程，不转换成 std::function，每次调用都不分配堆内存
+    template <typename F>
+    void parallel_for(std::size_t n_tasks, F &&fn)
+    {
+        using Fn = std::remove_reference_t<F>;
+        if (run_inline(n_tasks))
+        {
+            for (std::size_t task = 0; task < n_tasks; ++task)
+            {
+                fn(task);
+            }
+            return;
+        }
+        dispatch(n_tasks, TaskRef{const_cast<void *>(static_cast<const void *>(std::addressof(fn))),
+                                  [](void *object, std::size_t task)
+                                  { (*static_cast<Fn *>(object))(task); }});
+    }
+    // 把 [0, n) 按 grain 大小切块并行处理，fn(begin, end)
+    template <typename F>
+    void parallel_for_blocks(std::size_t n, std::size_t grain, F &&fn)
+    {
+        const std::size_t blocks = (n + grain - 1) / grain;
+        parallel_for(blocks, [&](std::size_t b)
+                     { fn(b * grain, std::min(n, (b + 1) * grain)); });
+    }
+
+    // 把线程数配置（0 表示全部硬件线程）解析为实际线程数
+    static int resolve(int num_threads);
+
+private:
+    // 不拥有可调用对象的任务引用；dispatch 阻塞到全部任务完成，被引用的对象在此期间一直有效
+    struct TaskRef
+    {
+        void *object;
+        void (*call)(void *, std::size_t);
+
+        void operator()(std::size_t task) const { call(object, task); }
+    };
+
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::mutex submit_mutex_;
+    std::condition_variable start_cv_;
+    std::condition_variable done_cv_;
+    TaskRef job_{nullptr, nullptr};
+    std::size_t job_size_ = 0;
+    std::atomic<std::size_t> next_{0};
+    std::size_t active_ = 0;
+    std::uint64_t generation_ = 0;
+    bool stop_ = false;
+    std::exception_ptr error_;
+
+    void worker_loop();
+    void run_tasks();
+    // 单线程、单任务或在本线程池的任务中嵌套调用时直接串行执行
+    bool run_inline(std::size_t n_tasks) const;
+    // 把 job 交给全部线程执行并等待完成
+    void dispatch(std::size_t n_tasks, TaskRef job);
+};
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,124 @@
+#include "coreset.h"
+#include "distance.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+#include <utility>
+
+namespace
+{
+    // 采样扫描时每个任务处理的样本数；每块使用独立的随机流，块的划分与线程数无关
+    constexpr std::size_t kCoresetGrain = 4096;
+
+    template <typename T>
+    Coreset<T> build_coreset_impl(const MatrixView<T> &data, const CoresetOptions &options)
+    {
+        const std::size_t n = data.rows();
+        const std::size_t d = data.cols();
+        if (data.empty())
+        {
+            throw std::invalid_argument("build_coreset requires non-empty data");
+        }
+        if (options.size == 0)
+        {
+            throw std::invalid_argument("build_coreset: size must be positive");
+        }
+        const std::uint64_t seed = options.seed ? *options.seed : std::random_device{}();
+        std::mt19937_64 rng(seed);
+
+        // 用均匀分层抽样估计参考中心 μ 和平均平方距离；抽样行按行号递增，对内存映射数据也是顺序访问
+        const std::size_t pilot = std::min(n, std::max<std::size_t>(1, options.pilot_size));
+        const double stride = static_cast<double>(n) / pilot;
+        std::uniform_real_distribution<double> jitter(0.0, 1.0);
+        std::vector<std::size_t> pilot_rows(pilot);
+        for (std::size_t s = 0; s < pilot; ++s)
+        {
+            pilot_rows[s] = pilot == n ? s : std::min(n - 1, static_cast<std::size_t>((s + jitter(rng)) * stride));
+        }
+        AlignedVector<T> mean(d, T(0));
+        std::vector<double> mean_acc(d, 0.0);
+        for (std::size_t row : pilot_rows)
+        {
+            for (std::size_t j = 0; j < d; ++j)
+            {
+                mean_acc[j] += data(row, j);
+            }
+        }
+        for (std::size_t j = 0; j < d; ++j)
+        {
+            mean[j] = static_cast<T>(mean_acc[j] / pilot);
+        }
+        double pilot_cost = 0.0;
+        for (std::size_t row : pilot_rows)
+        {
+            pilot_cost += simd::squared_l2(data, row, mean.data());
+        }
+        const double mean_cost = pilot_cost / pilot;
+
+        // 一次并行扫描：每个样本按 p = min(1, m·q) 独立入选（Poisson 采样），入选样本的权重为 1/p
+        const double m = static_cast<double>(options.size);
+        const std::size_t blocks = (n + kCoresetGrain - 1) / kCoresetGrain;
+        std::vector<std::vector<std::pair<std::size_t, double>>> picks(blocks);
+        ThreadPool pool(options.num_threads);
+        pool.parallel_for(blocks, [&](std::size_t b)
+                          {
+            std::seed_seq block_seed{static_cast<std::uint32_t>(seed), static_cast<std::uint32_t>(seed >> 32),
+                                     static_cast<std::uint32_t>(b), static_cast<std::uint32_t>(b >> 32)};
+            std::mt19937_64 gen(block_seed);
+            std::uniform_real_distribution<double> uniform(0.0, 1.0);
+            const std::size_t end = std::min(n, (b + 1) * kCoresetGrain);
+            for (std::size_t i = b * kCoresetGrain; i < end; ++i)
+            {
+                double q = 1.0 / n;
+                if (mean_cost > 0.0)
+                {
+                    q = 0.5 / n + 0.5 * simd::squared_l2(data, i, mean.data()) / (n * mean_cost);
+                }
+                const double p = std::min(1.0, m * q);
+                if (uniform(gen) < p)
+                {
+                    picks[b].emplace_back(i, 1.0 / p);
+                }
+            } });
+
+        std::size_t total = 0;
+        for (const auto &block : picks)
+        {
+            total += block.size();
+        }
+        // size 远小于 1 时可能一个样本都没有入选，空的加权点集无法用于后续训练
+        if (total == 0)
+        {
+            throw std::runtime_error("build_coreset: no rows were sampled, increase size");
+        }
+        Coreset<T> coreset;
+        coreset.points.resize(total, d);
+        coreset.weights.reserve(total);
+        coreset.indices.reserve(total);
+        for (const auto &block : picks)
+        {
+            for (const auto &pick : block)
+            {
+                T *dst = coreset.points.row(coreset.indices.size());
+                for (std::size_t j = 0; j < d; ++j)
+                {
+                    dst[j] = data(pick.first, j);
+                }
+                coreset.indices.push_back(pick.first);
+                coreset.weights.push_back(pick.second);
+            }
+        }
+        return coreset;
+    }
+}
+
+Coreset<float> build_coreset(const MatrixView<float> &data, const CoresetOptions &options)
+{
+    return build_coreset_impl(data, options);
+}
+
+Coreset<double> build_coreset(const MatrixView<double> &data, const CoresetOptions &options)
+{
+    return build_coreset_impl(data, options);
+}
@@ -1,7 +1,610 @@
 #include "gradient_descent.h"
+#include "distance.h"
+#include "sparse.h"
+#include "thread_pool.h"
+#include <Eigen/Dense>
+#include <atomic>
+#include <chrono>
+#include <deque>
 #include <iostream>
 #include <algorithm>
+#include <numeric>
 #include <random>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+namespace
+{
+    static_assert(std::is_standard_layout_v<Point> && sizeof(Point) == 2 * sizeof(double),
+                  "Point must be two packed doubles");
+
+    // 单特征线性回归在全部样本上的一次融合遍历：同时累加 sum(e·x)、sum(e)，WithLoss 时再累加 sum(e^2)，
+    // e = slope·x + b - y。Point 是两个紧密排列的 double，AVX 下一次读入 4 个点并拆出 x 与 y
+    template <bool WithLoss>
+    void linear_sums(const Point *points, std::size_t n, double slope, double intercept, double &sum_ex,
+                     double &sum_e, double &sum_ee)
+    {
+        const double *raw = reinterpret_cast<const double *>(points);
+        std::size_t i = 0;
+        sum_ex = 0.0;
+        sum_e = 0.0;
+        sum_ee = 0.0;
+#if defined(__AVX__)
+        const __m256d vs = _mm256_set1_pd(slope);
+        const __m256d vb = _mm256_set1_pd(intercept);
+        __m256d acc_ex = _mm256_setzero_pd();
+        __m256d acc_e = _mm256_setzero_pd();
+        __m256d acc_ee = _mm256_setzero_pd();
+        for (; i + 4 <= n; i += 4)
+        {
+            __m256d p0 = _mm256_loadu_pd(raw + 2 * i);
+            __m256d p1 = _mm256_loadu_pd(raw + 2 * i + 4);
+            // 两个寄存器按 128 位通道交错：得到 (x0, x2, x1, x3) 与 (y0, y2, y1, y3)，求和与顺序无关
+            __m256d x = _mm256_unpacklo_pd(p0, p1);
+            __m256d y = _mm256_unpackhi_pd(p0, p1);
+            __m256d e = _mm256_sub_pd(ML_SIMD_FMADD_PD(vs, x, vb), y);
+            acc_ex = ML_SIMD_FMADD_PD(e, x, acc_ex);
+            acc_e = _mm256_add_pd(acc_e, e);
+            if constexpr (WithLoss)
+            {
+                acc_ee = ML_SIMD_FMADD_PD(e, e, acc_ee);
+            }
+        }
+        sum_ex = simd::hsum(acc_ex);
+        sum_e = simd::hsum(acc_e);
+        sum_ee = simd::hsum(acc_ee);
+#endif
+        for (; i < n; ++i)
+        {
+            double e = (slope * raw[2 * i] + intercept) - raw[2 * i + 1];
+            sum_ex += e * raw[2 * i];
+            sum_e += e;
+            if constexpr (WithLoss)
+            {
+                sum_ee += e * e;
+            }
+        }
+    }
+
+    // 批量梯度按行块计算，每块约占这么多字节，保证块在 L2 缓存内被残差和梯度两次遍历复用
+    constexpr std::size_t kGradBlockBytes = std::size_t(256) << 10;
+
+    std::size_t grad_block_rows(std::size_t d)
+    {
+        return std::max<std::size_t>(16, kGradBlockBytes / (d * sizeof(double)));
+    }
+
+    // 行块线性预测 r[i - begin] = x_i·w + b
+    void block_linear(const MatrixView<double> &X, std::size_t begin, std::size_t end, const double *w, double b,
+                      double *r)
+    {
+        const std::size_t d = X.cols();
+        if (X.row_major())
+        {
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                r[i - begin] = simd::dot(X.row(i), w, d) + b;
+            }
+            return;
+        }
+        // 列优先：逐列累加 w_j · X[:, j]，沿样本方向连续访问
+        std::fill(r, r + (end - begin), b);
+        for (std::size_t j = 0; j < d; ++j)
+        {
+            simd::axpy(w[j], X.col(j) + begin, r, end - begin);
+        }
+    }
+
+    // 行块梯度 grad += X_bᵀ r
+    void block_gradient(const MatrixView<double> &X, std::size_t begin, std::size_t end, const double *r, double *grad)
+    {
+        const std::size_t d = X.cols();
+        if (X.row_major())
+        {
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                simd::axpy(r[i - begin], X.row(i), grad, d);
+            }
+            return;
+        }
+        for (std::size_t j = 0; j < d; ++j)
+        {
+            grad[j] += simd::dot(X.col(j) + begin, r, end - begin);
+        }
+    }
+
+    // 生成一个 epoch 的样本访问顺序，不移动数据本身。block <= 1 时为全排列；否则按 block 行分块，
+    // 打乱块的顺序并在块内打乱，小批量读到的是少数几段连续内存，对内存映射等大数据更友好。
+    // order 与 blocks 由调用方在 epoch 之间复用，不产生堆分配
+    void shuffle_order(std::vector<std::size_t> &order, std::vector<std::size_t> &blocks, std::size_t block,
+                       std::mt19937 &gen)
+    {
+        const std::size_t n = order.size();
+        if (block <= 1)
+        {
+            std::shuffle(order.begin(), order.end(), gen);
+            return;
+        }
+        blocks.resize((n + block - 1) / block);
+        std::iota(blocks.begin(), blocks.end(), std::size_t(0));
+        std::shuffle(blocks.begin(), blocks.end(), gen);
+        std::size_t pos = 0;
+        for (std::size_t b : blocks)
+        {
+            const std::size_t begin = pos;
+            for (std::size_t i = b * block; i < std::min(n, (b + 1) * block); ++i)
+            {
+                order[pos++] = i;
+            }
+            std::shuffle(order.begin() + begin, order.begin() + pos, gen);
+        }
+    }
+
+    // 单个样本的线性预测 x_i·w + b
+    double sample_linear(const MatrixView<double> &X, std::size_t i, const double *w, double b)
+    {
+        if (X.row_major())
+        {
+            return simd::dot(X.row(i), w, X.cols()) + b;
+        }
+        double sum = b;
+        for (std::size_t j = 0; j < X.cols(); ++j)
+        {
+            sum += X(i, j) * w[j];
+        }
+        return sum;
+    }
+
+    // 数据并行小批量的切片：每批最多切成 kBatchSlices 片，每片不少于 kMinSliceRows 行。切片划分只取决于批大小，
+    // 与线程数无关，保证归约顺序固定。批大小达到 2·kMinSliceRows 行时开始并行，达到 kBatchSlices·kMinSliceRows
+    // （1024）行时切满 64 片，足够 64 个线程分担
+    constexpr std::size_t kBatchSlices = 64;
+    constexpr std::size_t kMinSliceRows = 16;
+    // 分区不短于这个宽度时归约的每一层也交给线程池并行，更窄时调度开销大于加法本身
+    constexpr std::size_t kParallelReduceWidth = 256;
+    // 线性预测逐块换成残差时每块的行数
+    constexpr std::size_t kResidualBlockRows = 256;
+
+    // 固定顺序的树形归约：第 k 层对每个 i ≡ 0 (mod 2^(k+1)) 调用 combine(i, i + 2^k)，结果留在下标 0。
+    // 合并顺序只取决于 count，与线程数无关；同一层的配对互不重叠，parallel 时交给线程池并行
+    template <typename Combine>
+    void tree_reduce(ThreadPool &pool, std::size_t count, bool parallel, const Combine &combine)
+    {
+        for (std::size_t step = 1; step < count; step *= 2)
+        {
+            const std::size_t pairs = (count - step + 2 * step - 1) / (2 * step);
+            auto combine_pair = [&](std::size_t p)
+            {
+                combine(2 * step * p, 2 * step * p + step);
+            };
+            if (parallel)
+            {
+                pool.parallel_for(pairs, combine_pair);
+            }
+            else
+            {
+                for (std::size_t p = 0; p < pairs; ++p)
+                {
+                    combine_pair(p);
+                }
+            }
+        }
+    }
+
+    // 一个批次 count 个样本的梯度：切成至多 kBatchSlices 片，slice(s, lo, hi, partial) 把第 s 片即批内位置
+    // [lo, hi) 的梯度写入自己的 width 长分区，之后按固定顺序树形归约，返回归约结果（partials 的首个分区）
+    template <typename Slice>
+    double *batch_gradient(ThreadPool &pool, std::size_t count, std::size_t width, std::vector<double> &partials,
+                           const Slice &slice)
+    {
+        const std::size_t rows = std::max(kMinSliceRows, (count + kBatchSlices - 1) / kBatchSlices);
+        const std::size_t slices = (count + rows - 1) / rows;
+        partials.resize(std::max(partials.size(), slices * width));
+        pool.parallel_for(slices, [&](std::size_t s)
+                          {
+            double *partial = partials.data() + s * width;
+            std::fill(partial, partial + width, 0.0);
+            slice(s, s * rows, std::min(count, (s + 1) * rows), partial); });
+        // 分区较窄时串行归约，顺序不变
+        tree_reduce(pool, slices, width >= kParallelReduceWidth, [&](std::size_t dst_slice, std::size_t src_slice)
+                    {
+            double *dst = partials.data() + dst_slice * width;
+            const double *src = partials.data() + src_slice * width;
+            for (std::size_t k = 0; k < width; ++k)
+            {
+                dst[k] += src[k];
+            } });
+        return partials.data();
+    }
+
+    // dst += alpha · x_i
+    void sample_axpy(const MatrixView<double> &X, std::size_t i, double alpha, double *dst)
+    {
+        if (X.row_major())
+        {
+            simd::axpy(alpha, X.row(i), dst, X.cols());
+            return;
+        }
+        for (std::size_t j = 0; j < X.cols(); ++j)
+        {
+            dst[j] += alpha * X(i, j);
+        }
+    }
+
+    // r[0, n) 由线性预测换成族的残差 μ(η) - y，loss 非空时累加负对数似然之和。每块只分派一次，内层循环向量化
+    void family_residuals(GlmFamily family, double *r, const double *y, std::size_t n, double *loss)
+    {
+        glm::dispatch_family(family, [&](auto policy)
+                             { glm::residuals<decltype(policy)>(r, y, n, loss); });
+    }
+
+    // 单个样本的残差 μ(η) - y
+    double family_residual(GlmFamily family, double eta, double y)
+    {
+        return glm::dispatch_family(family, [&](auto policy)
+                                    { return decltype(policy)::residual(eta, y); });
+    }
+
+    double family_loss(GlmFamily family, double eta, double y)
+    {
+        return glm::dispatch_family(family, [&](auto policy)
+                                    { return decltype(policy)::loss(eta, y); });
+    }
+
+    // 最小二乘求解把样本按行号分成固定数量的连续分片，分片数不超过 kSolveMaxChunks，
+    // 且所有分片的部分结果合计不超过 kSolvePartialBytes
+    constexpr std::size_t kSolveMaxChunks = 64;
+    constexpr std::size_t kSolvePartialBytes = std::size_t(64) << 20;
+    // Auto 模式下正规矩阵的最大维度，超过时改用 L-BFGS
+    constexpr std::size_t kMaxNormalDim = 4096;
+    // Cholesky 因子对角元之比的平方（正规矩阵条件数的估计）超过这个值时视为病态
+    constexpr double kMaxNormalCondition = 1e10;
+    // L-BFGS 保存的曲率对数与每次迭代的最多回溯次数
+    constexpr std::size_t kLbfgsMemory = 10;
+    constexpr int kLbfgsMaxBacktracks = 30;
+
+    // 分片数只取决于样本数、行块大小与每个部分结果的字节数，与线程数无关
+    std::size_t solve_chunks(std::size_t n, std::size_t block_rows, std::size_t partial_bytes)
+    {
+        std::size_t chunks = std::min(kSolveMaxChunks, (n + block_rows - 1) / block_rows);
+        chunks = std::min(chunks, kSolvePartialBytes / partial_bytes);
+        return std::max<std::size_t>(1, chunks);
+    }
+
+    // 按行读取样本的统一接口：fill 把行 [begin, end) 展开成增广稠密块 [x, 1, y]，
+    // linear / residual / axpy 逐行计算 x·w + b、残差 x·w + b - y 与累加 alpha·x，target 返回 y。
+    // 最小二乘求解与 softmax 的各个调度共用
+    struct PointRows
+    {
+        const std::vector<Point> &data;
+
+        std::size_t rows() const { return data.size(); }
+        std::size_t cols() const { return 1; }
+
+        void fill(std::size_t begin, std::size_t end, Eigen::MatrixXd &block) const
+        {
+            block.resize(end - begin, 3);
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                block(i - begin, 0) = data[i].x;
+                block(i - begin, 1) = 1.0;
+                block(i - begin, 2) = data[i].y;
+            }
+        }
+
+        double target(std::size_t i) const { return data[i].y; }
+        double linear(std::size_t i, const double *w, double b) const { return w[0] * data[i].x + b; }
+        double residual(std::size_t i, const double *w, double b) const { return linear(i, w, b) - data[i].y; }
+        void axpy(std::size_t i, double alpha, double *g) const { g[0] += alpha * data[i].x; }
+    };
+
+    struct DenseRows
+    {
+        const MatrixView<double> &X;
+        const std::vector<double> &y;
+
+        std::size_t rows() const { return X.rows(); }
+        std::size_t cols() const { return X.cols(); }
+
+        void fill(std::size_t begin, std::size_t end, Eigen::MatrixXd &block) const
+        {
+            using RowMajor = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+            const Eigen::Index m = static_cast<Eigen::Index>(end - begin);
+            const Eigen::Index d = static_cast<Eigen::Index>(X.cols());
+            const Eigen::OuterStride<> stride(static_cast<Eigen::Index>(X.ld()));
+            block.resize(m, d + 2);
+            if (X.row_major())
+            {
+                block.leftCols(d) = Eigen::Map<const RowMajor, 0, Eigen::OuterStride<>>(X.row(begin), m, d, stride);
+            }
+            else
+            {
+                block.leftCols(d) = Eigen::Map<const Eigen::MatrixXd, 0, Eigen::OuterStride<>>(X.data() + begin, m, d, stride);
+            }
+            block.col(d).setOnes();
+            block.col(d + 1) = Eigen::Map<const Eigen::VectorXd>(y.data() + begin, m);
+        }
+
+        double target(std::size_t i) const { return y[i]; }
+        double linear(std::size_t i, const double *w, double b) const { return sample_linear(X, i, w, b); }
+        double residual(std::size_t i, const double *w, double b) const { return linear(i, w, b) - y[i]; }
+        void axpy(std::size_t i, double alpha, double *g) const { sample_axpy(X, i, alpha, g); }
+    };
+
+    struct SparseRows
+    {
+        const CsrMatrix<double> &X;
+        const std::vector<double> &y;
+
+        std::size_t rows() const { return X.rows(); }
+        std::size_t cols() const { return X.cols(); }
+
+        void fill(std::size_t begin, std::size_t end, Eigen::MatrixXd &block) const
+        {
+            const Eigen::Index d = static_cast<Eigen::Index>(X.cols());
+            block.setZero(static_cast<Eigen::Index>(end - begin), d + 2);
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                const std::uint32_t *idx = X.row_indices(i);
+                const double *val = X.row_values(i);
+                for (std::size_t p = 0; p < X.row_nnz(i); ++p)
+                {
+                    block(i - begin, idx[p]) = val[p];
+                }
+                block(i - begin, d) = 1.0;
+                block(i - begin, d + 1) = y[i];
+            }
+        }
+
+        double target(std::size_t i) const { return y[i]; }
+        double linear(std::size_t i, const double *w, double b) const
+        {
+            return simd::sparse_dot(X.row_indices(i), X.row_values(i), X.row_nnz(i), w) + b;
+        }
+        double residual(std::size_t i, const double *w, double b) const { return linear(i, w, b) - y[i]; }
+        void axpy(std::size_t i, double alpha, double *g) const
+        {
+            simd::sparse_axpy(X.row_indices(i), X.row_values(i), X.row_nnz(i), alpha, g);
+        }
+    };
+
+    // 一次并行遍历累加增广 Gram 矩阵 [X 1 y]ᵀ[X 1 y]，其中包含 XᵀX、Xᵀ1、n、Xᵀy 与 yᵀy。只维护下三角
+    template <typename Rows>
+    Eigen::MatrixXd accumulate_gram(const Rows &rows, ThreadPool &pool)
+    {
+        const std::size_t n = rows.rows();
+        const Eigen::Index width = static_cast<Eigen::Index>(rows.cols() + 2);
+        const std::size_t block_rows = grad_block_rows(width);
+        const std::size_t chunks = solve_chunks(n, block_rows, width * width * sizeof(double));
+        std::vector<Eigen::MatrixXd> partials(chunks);
+        pool.parallel_for(chunks, [&](std::size_t c)
+                          {
+            Eigen::MatrixXd &gram = partials[c];
+            gram.setZero(width, width);
+            Eigen::MatrixXd block;
+            const std::size_t end = n * (c + 1) / chunks;
+            for (std::size_t begin = n * c / chunks; begin < end; begin += block_rows)
+            {
+                rows.fill(begin, std::min(begin + block_rows, end), block);
+                gram.selfadjointView<Eigen::Lower>().rankUpdate(block.transpose());
+            } });
+        tree_reduce(pool, chunks, true, [&](std::size_t dst, std::size_t src)
+                    { partials[dst] += partials[src]; });
+        return std::move(partials[0]);
+    }
+
+    // 解正规方程 (XᵀX + nλE) θ = Xᵀy，θ = [w; b]，E 为除截距外的单位阵。分解失败或病态时返回 false
+    bool cholesky_solve(const Eigen::MatrixXd &gram, std::size_t n, double l2, Eigen::VectorXd &theta)
+    {
+        const Eigen::Index k = gram.rows() - 1;
+        Eigen::MatrixXd normal = gram.topLeftCorner(k, k);
+        normal.diagonal().head(k - 1).array() += n * l2;
+        Eigen::LLT<Eigen::MatrixXd, Eigen::Lower> llt(normal);
+        if (llt.info() != Eigen::Success)
+        {
+            return false;
+        }
+        const Eigen::VectorXd diag = llt.matrixLLT().diagonal();
+        const double ratio = diag.maxCoeff() / diag.minCoeff();
+        if (!(ratio * ratio < kMaxNormalCondition))
+        {
+            return false;
+        }
+        theta = llt.solve(gram.bottomLeftCorner(1, k).transpose());
+        return true;
+    }
+
+    // 把 r 与 rows 叠在一起做 Householder QR，r 替换为新的上三角因子（行数不超过列数）
+    void stack_qr(Eigen::MatrixXd &r, const Eigen::MatrixXd &rows)
+    {
+        Eigen::MatrixXd stacked(r.rows() + rows.rows(), r.cols());
+        stacked << r, rows;
+        const Eigen::HouseholderQR<Eigen::MatrixXd> qr(stacked);
+        const Eigen::Index k = std::min(stacked.rows(), stacked.cols());
+        r = qr.matrixQR().topRows(k).triangularView<Eigen::Upper>();
+    }
+
+    // 一次并行遍历得到增广矩阵 [X 1 y] 的 R 因子（TSQR）：每个分片逐行块地与当前 R 叠加做 QR，
+    // 分片的 R 再按固定顺序两两叠加归约。R 与 Gram 矩阵满足 RᵀR = [X 1 y]ᵀ[X 1 y]，但条件数不被平方
+    template <typename Rows>
+    Eigen::MatrixXd accumulate_qr(const Rows &rows, ThreadPool &pool)
+    {
+        const std::size_t n = rows.rows();
+        const Eigen::Index width = static_cast<Eigen::Index>(rows.cols() + 2);
+        const std::size_t block_rows = grad_block_rows(width);
+        const std::size_t chunks = solve_chunks(n, block_rows, width * width * sizeof(double));
+        std::vector<Eigen::MatrixXd> partials(chunks);
+        pool.parallel_for(chunks, [&](std::size_t c)
+                          {
+            Eigen::MatrixXd &r = partials[c];
+            r.resize(0, width);
+            Eigen::MatrixXd block;
+            const std::size_t end = n * (c + 1) / chunks;
+            for (std::size_t begin = n * c / chunks; begin < end; begin += block_rows)
+            {
+                rows.fill(begin, std::min(begin + block_rows, end), block);
+                stack_qr(r, block);
+            } });
+        tree_reduce(pool, chunks, true, [&](std::size_t dst, std::size_t src)
+                    { stack_qr(partials[dst], partials[src]); });
+        return std::move(partials[0]);
+    }
+
+    // 由 [X 1 y] 的 R 因子求解：正则化项作为 sqrt(nλ)·E 的额外行叠入 R，
+    // 再用完全正交分解解 R11 θ = r12，秩亏时给出最小范数解
+    Eigen::VectorXd qr_solve(Eigen::MatrixXd r, std::size_t n, double l2)
+    {
+        const Eigen::Index k = r.cols() - 1;
+        if (l2 > 0.0)
+        {
+            Eigen::MatrixXd ridge = Eigen::MatrixXd::Zero(k - 1, k + 1);
+            ridge.leftCols(k - 1).diagonal().setConstant(std::sqrt(n * l2));
+            stack_qr(r, ridge);
+        }
+        const Eigen::Index m = std::min(r.rows(), k);
+        Eigen::MatrixXd r11 = Eigen::MatrixXd::Zero(k, k);
+        Eigen::VectorXd r12 = Eigen::VectorXd::Zero(k);
+        r11.topRows(m) = r.topLeftCorner(m, k);
+        r12.head(m) = r.col(k).head(m);
+        return Eigen::CompleteOrthogonalDecomposition<Eigen::MatrixXd>(r11).solve(r12);
+    }
+
+    // 一次并行遍历计算 f(θ) = (1/2n)‖Xw + b - y‖² + (λ/2)‖w‖² 及其梯度，θ = [w; b]
+    template <typename Rows>
+    double loss_gradient(const Rows &rows, ThreadPool &pool, double l2, const Eigen::VectorXd &theta,
+                         Eigen::VectorXd &grad)
+    {
+        const std::size_t n = rows.rows();
+        const Eigen::Index d = static_cast<Eigen::Index>(rows.cols());
+        // 每个分区为 d 个权重梯度、截距梯度与残差平方和
+        const std::size_t chunks = solve_chunks(n, grad_block_rows(d + 2), (d + 2) * sizeof(double));
+        std::vector<Eigen::VectorXd> partials(chunks);
+        pool.parallel_for(chunks, [&](std::size_t c)
+                          {
+            Eigen::VectorXd &partial = partials[c];
+            partial.setZero(d + 2);
+            for (std::size_t i = n * c / chunks; i < n * (c + 1) / chunks; ++i)
+            {
+                const double e = rows.residual(i, theta.data(), theta[d]);
+                rows.axpy(i, e, partial.data());
+                partial[d] += e;
+                partial[d + 1] += e * e;
+            } });
+        tree_reduce(pool, chunks, true, [&](std::size_t dst, std::size_t src)
+                    { partials[dst] += partials[src]; });
+        grad = partials[0].head(d + 1) / static_cast<double>(n);
+        grad.head(d) += l2 * theta.head(d);
+        return partials[0][d + 1] / (2.0 * n) + 0.5 * l2 * theta.head(d).squaredNorm();
+    }
+
+    // L-BFGS：两循环递推求方向，回溯线搜索满足 Armijo 条件，梯度无穷范数小于 tolerance 时停止。
+    // 每次函数求值遍历一次数据；每轮结束时调用 report(iter, loss)
+    template <typename Rows, typename Report>
+    void lbfgs_solve(const Rows &rows, ThreadPool &pool, double l2, int max_iterations, double tolerance,
+                     Eigen::VectorXd &theta, const Report &report)
+    {
+        Eigen::VectorXd grad, next, next_grad, direction;
+        double loss = loss_gradient(rows, pool, l2, theta, grad);
+        std::deque<Eigen::VectorXd> s_hist, y_hist;
+        std::deque<double> rho;
+        std::vector<double> alpha(kLbfgsMemory);
+        for (int iter = 0; iter < max_iterations && grad.lpNorm<Eigen::Infinity>() >= tolerance; ++iter)
+        {
+            direction = -grad;
+            for (std::size_t j = s_hist.size(); j-- > 0;)
+            {
+                alpha[j] = rho[j] * s_hist[j].dot(direction);
+                direction -= alpha[j] * y_hist[j];
+            }
+            // 初始 Hessian 取 sᵀy / yᵀy；还没有曲率信息时把第一步限制在单位长度内
+            direction *= s_hist.empty() ? 1.0 / std::max(1.0, grad.norm())
+                                        : s_hist.back().dot(y_hist.back()) / y_hist.back().squaredNorm();
+            for (std::size_t j = 0; j < s_hist.size(); ++j)
+            {
+                direction += (alpha[j] - rho[j] * y_hist[j].dot(direction)) * s_hist[j];
+            }
+
+            double slope = grad.dot(direction);
+            if (!(slope < 0.0))
+            {
+                direction = -grad;
+                slope = -grad.squaredNorm();
+                s_hist.clear();
+                y_hist.clear();
+                rho.clear();
+            }
+            double step = 1.0;
+            double next_loss = loss;
+            for (int tries = 0; tries <= kLbfgsMaxBacktracks; ++tries, step *= 0.5)
+            {
+                next = theta + step * direction;
+                next_loss = loss_gradient(rows, pool, l2, next, next_grad);
+                if (next_loss <= loss + 1e-4 * step * slope)
+                {
+                    break;
+                }
+            }
+            if (!(next_loss < loss))
+            {
+                break;
+            }
+
+            Eigen::VectorXd s = next - theta;
+            Eigen::VectorXd y = next_grad - grad;
+            const double sy = s.dot(y);
+            if (sy > 1e-12 * s.norm() * y.norm())
+            {
+                if (s_hist.size() == kLbfgsMemory)
+                {
+                    s_hist.pop_front();
+                    y_hist.pop_front();
+                    rho.pop_front();
+                }
+                s_hist.push_back(std::move(s));
+                y_hist.push_back(std::move(y));
+                rho.push_back(1.0 / sy);
+            }
+            theta.swap(next);
+            grad.swap(next_grad);
+            loss = next_loss;
+            report(iter, loss);
+        }
+    }
+
+    // 样本 i 的 K 个线性预测换成交叉熵对它们的梯度 p - onehot(y_i)，写入 eta，返回该样本的交叉熵。
+    // 类别 c 的权重为 w[c·d, (c+1)·d)，截距为 b[c]
+    template <typename Rows>
+    double softmax_sample(const Rows &rows, std::size_t i, const double *w, const double *b, std::size_t k, double *eta)
+    {
+        const std::size_t d = rows.cols();
+        for (std::size_t c = 0; c < k; ++c)
+        {
+            eta[c] = rows.linear(i, w + c * d, b[c]);
+        }
+        return glm::softmax_residuals(eta, k, static_cast<std::size_t>(rows.target(i)));
+    }
+
+    // softmax 的一个切片：把批内位置 [lo, hi) 的样本 batch[p] 的 p - onehot 按类别累加到 partial 的 K×d 个
+    // 权重梯度与其后 K 个截距梯度上，返回这些样本的交叉熵之和。eta 为该切片 K 个元素的暂存区
+    template <typename Rows>
+    double softmax_slice(const Rows &rows, const std::size_t *batch, std::size_t lo, std::size_t hi, const double *w,
+                         const double *b, std::size_t k, double *eta, double *partial)
+    {
+        const std::size_t d = rows.cols();
+        double loss = 0.0;
+        for (std::size_t p = lo; p < hi; ++p)
+        {
+            loss += softmax_sample(rows, batch[p], w, b, k, eta);
+            for (std::size_t c = 0; c < k; ++c)
+            {
+                rows.axpy(batch[p], eta[c], partial + c * d);
+                partial[k * d + c] += eta[c];
+            }
+        }
+        return loss;
+    }
+}
 
 GradientDescent::GradientDescent(double learning_rate, int max_iteration, double tolerance)
     : learning_rate_(learning_rate), max_iterations_(max_iteration), tolerance_(tolerance), slope_(0.0), intercept_(0.0)
@@ -10,91 +613,818 @@ GradientDescent::GradientDescent(double learning_rate, int max_iteration, double
 
 double GradientDescent::compute_loss(const std::vector<Point> &data) const
 {
-    double loss = 0.0;
-    for (const auto &point : data)
-    {
-        double error = (slope_ * point.x + intercept_) - point.y;
-        loss += error * error;
-    }
+    double sum_ex, sum_e, loss;
+    linear_sums<true>(data.data(), data.size(), slope_, intercept_, sum_ex, sum_e, loss);
     return loss / (2 * data.size());
 }
-void GradientDescent::update_parameters(const std::vector<Point> &data, double &grad_slope, double &grad_intercept)
+
+// 融合的梯度与损失：一次遍历数据得到梯度，loss 非空时顺带得到更新前参数下的损失，之后再更新参数
+void GradientDescent::update_parameters(const std::vector<Point> &data, Optimizer &optimizer, double &grad_slope,
+                                        double &grad_intercept, double *loss)
 {
-    grad_slope = 0.0;
-    grad_intercept = 0.0;
-    for (const auto &point : data)
+    double sum_ee;
+    if (loss)
     {
-        double error = (slope_ * point.x + intercept_) - point.y;
-        grad_slope += error * point.x;
-        grad_intercept += error;
+        linear_sums<true>(data.data(), data.size(), slope_, intercept_, grad_slope, grad_intercept, sum_ee);
+        *loss = sum_ee / (2 * data.size());
+    }
+    else
+    {
+        linear_sums<false>(data.data(), data.size(), slope_, intercept_, grad_slope, grad_intercept, sum_ee);
     }
     grad_slope /= data.size();
     grad_intercept /= data.size();
-    slope_ -= learning_rate_ * grad_slope;
-    intercept_ -= learning_rate_ * grad_intercept;
+    optimizer.step(&slope_, &grad_slope, intercept_, grad_intercept);
+}
+
+std::uint64_t GradientDescent::shuffle_seed() const
+{
+    return seed_ ? *seed_ : std::random_device{}();
+}
+
+bool GradientDescent::report_iteration(int iter) const
+{
+    return loss_interval_ > 0 && iter % loss_interval_ == 0;
 }
 
 void GradientDescent::batch_gradient_descent(const std::vector<Point> &data)
 {
+    require_gaussian("batch_gradient_descent(Point)");
+    Optimizer optimizer(optimizer_, learning_rate_, 1);
     for (int iter = 0; iter < max_iterations_; ++iter)
     {
-        double grad_slope, grad_intercept;
-        update_parameters(data, grad_slope, grad_intercept);
-        double loss = compute_loss(data);
+        // 只有需要输出的轮次才顺带计算损失，不再单独遍历一次数据
+        const bool report = report_iteration(iter);
+        double grad_slope, grad_intercept, loss = 0.0;
+        update_parameters(data, optimizer, grad_slope, grad_intercept, report ? &loss : nullptr);
         if (std::abs(grad_slope) < tolerance_ && std::abs(grad_intercept) < tolerance_)
         {
             std::cout << "Batch GD converged at iteration  " << iter + 1 << std::endl;
             break;
         }
-        if (iter % 10 == 0)
+        if (report)
         {
             std::cout << "Iteration " << iter + 1 << " loss: " << loss << std::endl;
         }
     }
 }
 
-void GradientDescent::stochastic_gradient_descent( std::vector<Point> &data)
+void GradientDescent::stochastic_gradient_descent(const std::vector<Point> &data)
 {
-    std::random_device rd;
-    std::mt19937 gen(rd());
+    require_gaussian("stochastic_gradient_descent(Point)");
+    std::mt19937 gen(static_cast<std::mt19937::result_type>(shuffle_seed()));
+    std::vector<std::size_t> order(data.size());
+    std::vector<std::size_t> blocks;
+    std::iota(order.begin(), order.end(), std::size_t(0));
     for (int iter = 0; iter < max_iterations_; ++iter)
     {
-        std::shuffle(data.begin(), data.end(), gen);
-        for (const auto &point : data)
+        shuffle_order(order, blocks, shuffle_block_, gen);
+        for (std::size_t i : order)
         {
+            const Point &point = data[i];
             double grad_slope = ((slope_ * point.x + intercept_) - point.y) * point.x;
             double grad_intercept = (slope_ * point.x + intercept_) - point.y;
             slope_ -= learning_rate_ * grad_slope;
             intercept_ -= learning_rate_ * grad_intercept;
         }
-        double loss = compute_loss(data);
-        if (iter % 10 == 0)
+        if (report_iteration(iter))
         {
-            std::cout << "Iteration " << iter + 1 << " loss: " << loss << std::endl;
+            std::cout << "Iteration " << iter + 1 << " loss: " << compute_loss(data) << std::endl;
         }
     }
 }
 
-void GradientDescent::mini_batch_gradient_descent( std::vector<Point> &data, int batch_size)
+void GradientDescent::mini_batch_gradient_descent(const std::vector<Point> &data, int batch_size)
 {
-    std::random_device rd;
-    std::mt19937 gen(rd());
+    require_gaussian("mini_batch_gradient_descent(Point)");
+    if (batch_size <= 0)
+    {
+        throw std::invalid_argument("GradientDescent: batch_size must be positive");
+    }
+    std::mt19937 gen(static_cast<std::mt19937::result_type>(shuffle_seed()));
+    // 每个 epoch 只重新排列下标，批次直接引用 order 中的一段，不复制样本也不修改调用方的数据
+    std::vector<std::size_t> order(data.size());
+    std::vector<std::size_t> blocks;
+    std::iota(order.begin(), order.end(), std::size_t(0));
+    ThreadPool pool(num_threads_);
+    Optimizer optimizer(optimizer_, learning_rate_, 1);
+    std::vector<double> partials;
 
     for (int iter = 0; iter < max_iterations_; ++iter)
     {
-        std::shuffle(data.begin(), data.end(), gen);
+        shuffle_order(order, blocks, shuffle_block_, gen);
 
         for (size_t i = 0; i < data.size(); i += batch_size)
         {
-            std::vector<Point> batch(data.begin() + i, data.begin() + std::min(i + batch_size, data.size()));
-            double grad_slope, grad_intercept;
-            update_parameters(batch, grad_slope, grad_intercept);
+            const std::size_t count = std::min<std::size_t>(batch_size, data.size() - i);
+            const std::size_t *batch = order.data() + i;
+            const double *grad = batch_gradient(pool, count, 2, partials,
+                                                [&](std::size_t, std::size_t lo, std::size_t hi, double *partial)
+                                                {
+                                                    for (std::size_t p = lo; p < hi; ++p)
+                                                    {
+                                                        const Point &point = data[batch[p]];
+                                                        double error = (slope_ * point.x + intercept_) - point.y;
+                                                        partial[0] += error * point.x;
+                                                        partial[1] += error;
+                                                    }
+                                                });
+            const double grad_slope = grad[0] / count;
+            optimizer.step(&slope_, &grad_slope, intercept_, grad[1] / count);
+        }
+
+        if (report_iteration(iter))
+        {
+            std::cout << "Iteration " << iter + 1 << ": Cost = " << compute_loss(data) << "\n";
+        }
+    }
+}
+
+std::size_t GradientDescent::online_gradient_descent(PointStream &stream)
+{
+    require_gaussian("online_gradient_descent");
+    std::vector<Point> chunk;
+    std::size_t seen = 0;
+    for (int index = 0; stream.next(chunk); ++index)
+    {
+        if (report_iteration(index))
+        {
+            std::cout << "Chunk " << index + 1 << " loss: " << compute_loss(chunk) << std::endl;
+        }
+        for (const Point &point : chunk)
+        {
+            double error = (slope_ * point.x + intercept_) - point.y;
+            slope_ -= learning_rate_ * error * point.x;
+            intercept_ -= learning_rate_ * error;
+        }
+        seen += chunk.size();
+    }
+    return seen;
+}
+
+std::size_t GradientDescent::online_gradient_descent(int fd, const PointStreamOptions &options)
+{
+    PointStream stream(fd, options);
+    return online_gradient_descent(stream);
+}
+
+void GradientDescent::prepare_weights(std::size_t rows, std::size_t cols, const std::vector<double> &y)
+{
+    if (rows == 0 || cols == 0 || rows != y.size())
+    {
+        throw std::invalid_argument("GradientDescent: X must be non-empty and match the size of y");
+    }
+    if (family_ == GlmFamily::Softmax)
+    {
+        if (num_classes_ < 2)
+        {
+            throw std::invalid_argument("GradientDescent: softmax requires at least two classes");
+        }
+        for (double label : y)
+        {
+            if (!(label >= 0.0 && label < static_cast<double>(num_classes_)) || label != std::floor(label))
+            {
+                throw std::invalid_argument("GradientDescent: softmax targets must be class indices in [0, num_classes)");
+            }
+        }
+    }
+    else
+    {
+        const bool valid = glm::dispatch_family(family_, [&](auto policy)
+                                                { return std::all_of(y.begin(), y.end(), [](double v)
+                                                                     { return decltype(policy)::valid(v); }); });
+        if (!valid)
+        {
+            throw std::invalid_argument("GradientDescent: targets are outside the support of the GLM family");
+        }
+    }
+    // Softmax 每个类别各有一组权重与截距
+    const std::size_t classes = family_ == GlmFamily::Softmax ? num_classes_ : 1;
+    if (weights_.size() != classes * cols || intercepts_.size() != (classes > 1 ? classes : 0))
+    {
+        weights_.assign(classes * cols, 0.0);
+        intercept_ = 0.0;
+        intercepts_.assign(classes > 1 ? classes : 0, 0.0);
+    }
+}
+
+void GradientDescent::require_gaussian(const char *what) const
+{
+    if (family_ != GlmFamily::Gaussian)
+    {
+        throw std::invalid_argument(std::string("GradientDescent: ") + what + " supports only the Gaussian family");
+    }
+}
+
+template <typename Rows>
+double GradientDescent::softmax_loss(const Rows &rows) const
+{
+    std::vector<double> eta(num_classes_);
+    double loss = 0.0;
+    for (std::size_t i = 0; i < rows.rows(); ++i)
+    {
+        loss += softmax_sample(rows, i, weights_.data(), intercepts_.data(), num_classes_, eta.data());
+    }
+    return loss / rows.rows();
+}
+
+// 一次遍历累加各类别的梯度与交叉熵，按类别各做一次参数更新。整个数据集作为一个批次交给小批量的切片与
+// 固定顺序归约并行计算，每个切片的分区为 K×d 个权重梯度、K 个截距梯度与最后一个交叉熵之和
+template <typename Rows>
+void GradientDescent::softmax_batch(const Rows &rows)
+{
+    const std::size_t n = rows.rows();
+    const std::size_t k = num_classes_;
+    const std::size_t d = rows.cols();
+    const std::size_t width = k * (d + 1) + 1;
+    std::vector<std::size_t> order(n);
+    std::iota(order.begin(), order.end(), std::size_t(0));
+    ThreadPool pool(num_threads_);
+    std::vector<Optimizer> optimizers(k, Optimizer(optimizer_, learning_rate_, d));
+    std::vector<double> partials;
+    std::vector<double> etas(kBatchSlices * k);
+    for (int iter = 0; iter < max_iterations_; ++iter)
+    {
+        double *grad = batch_gradient(pool, n, width, partials,
+                                      [&](std::size_t s, std::size_t lo, std::size_t hi, double *partial)
+                                      {
+                                          partial[width - 1] = softmax_slice(rows, order.data(), lo, hi, weights_.data(),
+                                                                             intercepts_.data(), k, etas.data() + s * k,
+                                                                             partial);
+                                      });
+        const double scale = 1.0 / n;
+        double max_grad = 0.0;
+        for (std::size_t j = 0; j < k * (d + 1); ++j)
+        {
+            grad[j] *= scale;
+            max_grad = std::max(max_grad, std::abs(grad[j]));
+        }
+        for (std::size_t c = 0; c < k; ++c)
+        {
+            optimizers[c].step(weights_.data() + c * d, grad + c * d, intercepts_[c], grad[k * d + c]);
+        }
+
+        if (max_grad < tolerance_)
+        {
+            std::cout << "Batch GD converged at iteration  " << iter + 1 << std::endl;
+            break;
+        }
+        if (report_iteration(iter))
+        {
+            std::cout << "Iteration " << iter + 1 << " loss: " << grad[width - 1] * scale << std::endl;
+        }
+    }
+}
+
+template <typename Rows>
+void GradientDescent::softmax_sgd(const Rows &rows)
+{
+    const std::size_t k = num_classes_;
+    const std::size_t d = rows.cols();
+    std::mt19937 gen(static_cast<std::mt19937::result_type>(shuffle_seed()));
+    std::vector<std::size_t> order(rows.rows());
+    std::vector<std::size_t> blocks;
+    std::iota(order.begin(), order.end(), std::size_t(0));
+    std::vector<double> eta(k);
+    for (int iter = 0; iter < max_iterations_; ++iter)
+    {
+        shuffle_order(order, blocks, shuffle_block_, gen);
+        for (std::size_t i : order)
+        {
+            // 先算出全部 K 个残差，再更新各类别的权重
+            softmax_sample(rows, i, weights_.data(), intercepts_.data(), k, eta.data());
+            for (std::size_t c = 0; c < k; ++c)
+            {
+                rows.axpy(i, -learning_rate_ * eta[c], weights_.data() + c * d);
+                intercepts_[c] -= learning_rate_ * eta[c];
+            }
+        }
+        if (report_iteration(iter))
+        {
+            std::cout << "Iteration " << iter + 1 << " loss: " << softmax_loss(rows) << std::endl;
+        }
+    }
+}
+
+// 与回归的小批量版本共用切片与固定顺序归约，每个切片的分区为 K×d 个权重梯度加最后 K 个截距梯度，
+// 每个切片各有 K 个元素的暂存区，训练开始时一次分配
+template <typename Rows>
+void GradientDescent::softmax_mini_batch(const Rows &rows, int batch_size)
+{
+    const std::size_t n = rows.rows();
+    const std::size_t k = num_classes_;
+    const std::size_t d = rows.cols();
+    std::mt19937 gen(static_cast<std::mt19937::result_type>(shuffle_seed()));
+    std::vector<std::size_t> order(n);
+    std::vector<std::size_t> blocks;
+    std::iota(order.begin(), order.end(), std::size_t(0));
+    ThreadPool pool(num_threads_);
+    std::vector<Optimizer> optimizers(k, Optimizer(optimizer_, learning_rate_, d));
+    std::vector<double> partials;
+    std::vector<double> etas(kBatchSlices * k);
+    for (int iter = 0; iter < max_iterations_; ++iter)
+    {
+        shuffle_order(order, blocks, shuffle_block_, gen);
+        for (std::size_t i = 0; i < n; i += batch_size)
+        {
+            const std::size_t count = std::min<std::size_t>(batch_size, n - i);
+            const std::size_t *batch = order.data() + i;
+            double *grad = batch_gradient(pool, count, k * (d + 1), partials,
+                                          [&](std::size_t s, std::size_t lo, std::size_t hi, double *partial)
+                                          {
+                                              softmax_slice(rows, batch, lo, hi, weights_.data(), intercepts_.data(), k,
+                                                            etas.data() + s * k, partial);
+                                          });
+            for (std::size_t j = 0; j < k * (d + 1); ++j)
+            {
+                grad[j] /= count;
+            }
+            for (std::size_t c = 0; c < k; ++c)
+            {
+                optimizers[c].step(weights_.data() + c * d, grad + c * d, intercepts_[c], grad[k * d + c]);
+            }
+        }
+
+        if (report_iteration(iter))
+        {
+            std::cout << "Iteration " << iter + 1 << ": Cost = " << softmax_loss(rows) << "\n";
+        }
+    }
+}
+
+double GradientDescent::compute_loss(const CsrMatrix<double> &X, const std::vector<double> &y) const
+{
+    if (family_ == GlmFamily::Softmax)
+    {
+        return softmax_loss(SparseRows{X, y});
+    }
+    double loss = 0.0;
+    for (std::size_t i = 0; i < X.rows(); ++i)
+    {
+        double eta = simd::sparse_dot(X.row_indices(i), X.row_values(i), X.row_nnz(i), weights_.data()) + intercept_;
+        loss += family_loss(family_, eta, y[i]);
+    }
+    return loss / X.rows();
+}
+
+void GradientDescent::batch_gradient_descent(const CsrMatrix<double> &X, const std::vector<double> &y)
+{
+    prepare_weights(X.rows(), X.cols(), y);
+    if (family_ == GlmFamily::Softmax)
+    {
+        softmax_batch(SparseRows{X, y});
+        return;
+    }
+    Optimizer optimizer(optimizer_, learning_rate_, X.cols());
+    std::vector<double> grad(X.cols());
+    std::vector<double> r(kResidualBlockRows);
+    for (int iter = 0; iter < max_iterations_; ++iter)
+    {
+        // 残差与权重的内积、梯度的累加都只访问非零元素。每块行先算出线性预测，再一次向量化地换成残差
+        std::fill(grad.begin(), grad.end(), 0.0);
+        const bool report = report_iteration(iter);
+        double grad_intercept = 0.0;
+        double loss = 0.0;
+        for (std::size_t begin = 0; begin < X.rows(); begin += kResidualBlockRows)
+        {
+            const std::size_t end = std::min(X.rows(), begin + kResidualBlockRows);
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                r[i - begin] = simd::sparse_dot(X.row_indices(i), X.row_values(i), X.row_nnz(i), weights_.data()) +
+                               intercept_;
+            }
+            family_residuals(family_, r.data(), y.data() + begin, end - begin, report ? &loss : nullptr);
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                simd::sparse_axpy(X.row_indices(i), X.row_values(i), X.row_nnz(i), r[i - begin], grad.data());
+                grad_intercept += r[i - begin];
+            }
+        }
+        const double scale = 1.0 / X.rows();
+        double max_grad = std::abs(grad_intercept * scale);
+        for (std::size_t j = 0; j < grad.size(); ++j)
+        {
+            grad[j] *= scale;
+            max_grad = std::max(max_grad, std::abs(grad[j]));
+        }
+        optimizer.step(weights_.data(), grad.data(), intercept_, grad_intercept * scale);
+
+        if (max_grad < tolerance_)
+        {
+            std::cout << "Batch GD converged at iteration  " << iter + 1 << std::endl;
+            break;
+        }
+        if (report)
+        {
+            std::cout << "Iteration " << iter + 1 << " loss: " << loss * scale << std::endl;
+        }
+    }
+}
+
+void GradientDescent::stochastic_gradient_descent(const CsrMatrix<double> &X, const std::vector<double> &y)
+{
+    prepare_weights(X.rows(), X.cols(), y);
+    if (family_ == GlmFamily::Softmax)
+    {
+        softmax_sgd(SparseRows{X, y});
+        return;
+    }
+    std::mt19937 gen(static_cast<std::mt19937::result_type>(shuffle_seed()));
+    // 打乱样本的访问顺序而不是数据本身，X 保持只读
+    std::vector<std::size_t> order(X.rows());
+    std::vector<std::size_t> blocks;
+    std::iota(order.begin(), order.end(), std::size_t(0));
+    for (int iter = 0; iter < max_iterations_; ++iter)
+    {
+        shuffle_order(order, blocks, shuffle_block_, gen);
+        for (std::size_t i : order)
+        {
+            const std::uint32_t *idx = X.row_indices(i);
+            const double *val = X.row_values(i);
+            const std::size_t nnz = X.row_nnz(i);
+            double error = family_residual(family_, simd::sparse_dot(idx, val, nnz, weights_.data()) + intercept_, y[i]);
+            simd::sparse_axpy(idx, val, nnz, -learning_rate_ * error, weights_.data());
+            intercept_ -= learning_rate_ * error;
+        }
+        if (report_iteration(iter))
+        {
+            std::cout << "Iteration " << iter + 1 << " loss: " << compute_loss(X, y) << std::endl;
+        }
+    }
+}
+
+double GradientDescent::compute_loss(const MatrixView<double> &X, const std::vector<double> &y) const
+{
+    if (family_ == GlmFamily::Softmax)
+    {
+        return softmax_loss(DenseRows{X, y});
+    }
+    const std::size_t block = grad_block_rows(X.cols());
+    std::vector<double> r(block);
+    double loss = 0.0;
+    for (std::size_t begin = 0; begin < X.rows(); begin += block)
+    {
+        const std::size_t end = std::min(X.rows(), begin + block);
+        block_linear(X, begin, end, weights_.data(), intercept_, r.data());
+        family_residuals(family_, r.data(), y.data() + begin, end - begin, &loss);
+    }
+    return loss / X.rows();
+}
+
+void GradientDescent::batch_gradient_descent(const MatrixView<double> &X, const std::vector<double> &y)
+{
+    prepare_weights(X.rows(), X.cols(), y);
+    if (family_ == GlmFamily::Softmax)
+    {
+        softmax_batch(DenseRows{X, y});
+        return;
+    }
+    const std::size_t d = X.cols();
+    const std::size_t block = grad_block_rows(d);
+    Optimizer optimizer(optimizer_, learning_rate_, d);
+    std::vector<double> grad(d);
+    std::vector<double> r(block);
+    for (int iter = 0; iter < max_iterations_; ++iter)
+    {
+        std::fill(grad.begin(), grad.end(), 0.0);
+        const bool report = report_iteration(iter);
+        double grad_intercept = 0.0;
+        double loss = 0.0;
+        for (std::size_t begin = 0; begin < X.rows(); begin += block)
+        {
+            const std::size_t end = std::min(X.rows(), begin + block);
+            // 线性预测换成残差时顺带累加损失，不需要再遍历一次数据
+            block_linear(X, begin, end, weights_.data(), intercept_, r.data());
+            family_residuals(family_, r.data(), y.data() + begin, end - begin, report ? &loss : nullptr);
+            block_gradient(X, begin, end, r.data(), grad.data());
+            for (std::size_t i = 0; i < end - begin; ++i)
+            {
+                grad_intercept += r[i];
+            }
+        }
+        const double scale = 1.0 / X.rows();
+        double max_grad = std::abs(grad_intercept * scale);
+        for (std::size_t j = 0; j < d; ++j)
+        {
+            grad[j] *= scale;
+            max_grad = std::max(max_grad, std::abs(grad[j]));
+        }
+        optimizer.step(weights_.data(), grad.data(), intercept_, grad_intercept * scale);
+
+        if (max_grad < tolerance_)
+        {
+            std::cout << "Batch GD converged at iteration  " << iter + 1 << std::endl;
+            break;
+        }
+        if (report)
+        {
+            std::cout << "Iteration " << iter + 1 << " loss: " << loss * scale << std::endl;
+        }
+    }
+}
+
+void GradientDescent::stochastic_gradient_descent(const MatrixView<double> &X, const std::vector<double> &y)
+{
+    prepare_weights(X.rows(), X.cols(), y);
+    if (family_ == GlmFamily::Softmax)
+    {
+        softmax_sgd(DenseRows{X, y});
+        return;
+    }
+    std::mt19937 gen(static_cast<std::mt19937::result_type>(shuffle_seed()));
+    std::vector<std::size_t> order(X.rows());
+    std::vector<std::size_t> blocks;
+    std::iota(order.begin(), order.end(), std::size_t(0));
+    for (int iter = 0; iter < max_iterations_; ++iter)
+    {
+        shuffle_order(order, blocks, shuffle_block_, gen);
+        for (std::size_t i : order)
+        {
+            double error = family_residual(family_, sample_linear(X, i, weights_.data(), intercept_), y[i]);
+            sample_axpy(X, i, -learning_rate_ * error, weights_.data());
+            intercept_ -= learning_rate_ * error;
+        }
+        if (report_iteration(iter))
+        {
+            std::cout << "Iteration " << iter + 1 << " loss: " << compute_loss(X, y) << std::endl;
+        }
+    }
+}
+
+void GradientDescent::mini_batch_gradient_descent(const MatrixView<double> &X, const std::vector<double> &y,
+                                                  int batch_size)
+{
+    prepare_weights(X.rows(), X.cols(), y);
+    if (batch_size <= 0)
+    {
+        throw std::invalid_argument("GradientDescent: batch_size must be positive");
+    }
+    if (family_ == GlmFamily::Softmax)
+    {
+        softmax_mini_batch(DenseRows{X, y}, batch_size);
+        return;
+    }
+    std::mt19937 gen(static_cast<std::mt19937::result_type>(shuffle_seed()));
+    const std::size_t n = X.rows();
+    const std::size_t d = X.cols();
+    std::vector<std::size_t> order(n);
+    std::vector<std::size_t> blocks;
+    std::iota(order.begin(), order.end(), std::size_t(0));
+    ThreadPool pool(num_threads_);
+    Optimizer optimizer(optimizer_, learning_rate_, d);
+    // 每个切片的分区为 d 个权重梯度加最后一个截距梯度
+    std::vector<double> partials;
+    for (int iter = 0; iter < max_iterations_; ++iter)
+    {
+        shuffle_order(order, blocks, shuffle_block_, gen);
+        for (std::size_t i = 0; i < n; i += batch_size)
+        {
+            const std::size_t count = std::min<std::size_t>(batch_size, n - i);
+            const std::size_t *batch = order.data() + i;
+            double *grad = batch_gradient(pool, count, d + 1, partials,
+                                          [&](std::size_t, std::size_t lo, std::size_t hi, double *partial)
+                                          {
+                                              // 每 kResidualBlockRows 行先收集线性预测与目标值，
+                                              // 一次向量化地换成残差，再累加梯度
+                                              double r[kResidualBlockRows];
+                                              double target[kResidualBlockRows];
+                                              for (std::size_t begin = lo; begin < hi; begin += kResidualBlockRows)
+                                              {
+                                                  const std::size_t end = std::min(hi, begin + kResidualBlockRows);
+                                                  for (std::size_t p = begin; p < end; ++p)
+                                                  {
+                                                      r[p - begin] = sample_linear(X, batch[p], weights_.data(),
+                                                                                   intercept_);
+                                                      target[p - begin] = y[batch[p]];
+                                                  }
+                                                  family_residuals(family_, r, target, end - begin, nullptr);
+                                                  for (std::size_t p = begin; p < end; ++p)
+                                                  {
+                                                      sample_axpy(X, batch[p], r[p - begin], partial);
+                                                      partial[d] += r[p - begin];
+                                                  }
+                                              }
+                                          });
+            for (std::size_t j = 0; j <= d; ++j)
+            {
+                grad[j] /= count;
+            }
+            optimizer.step(weights_.data(), grad, intercept_, grad[d]);
+        }
+
+        if (report_iteration(iter))
+        {
+            std::cout << "Iteration " << iter + 1 << ": Cost = " << compute_loss(X, y) << "\n";
+        }
+    }
+}
+
+// 分片按行号连续划分，与线程数一一对应；每个分片有自己的随机数流和访问顺序
+template <typename Sample, typename Report>
+void GradientDescent::run_hogwild(std::size_t n, const Sample &sample, const Report &report)
+{
+    ThreadPool pool(num_threads_);
+    const std::size_t shards = std::min<std::size_t>(pool.size(), n);
+    const std::uint64_t seed = shuffle_seed();
+    std::vector<std::vector<std::size_t>> orders(shards);
+    std::vector<std::vector<std::size_t>> blocks(shards);
+    std::vector<std::mt19937> gens;
+    for (std::size_t t = 0; t < shards; ++t)
+    {
+        orders[t].resize(n * (t + 1) / shards - n * t / shards);
+        std::iota(orders[t].begin(), orders[t].end(), std::size_t(0));
+        gens.emplace_back(static_cast<std::mt19937::result_type>(seed + t));
+    }
+    worker_stats_.assign(shards, WorkerStats());
+
+    for (int iter = 0; iter < max_iterations_; ++iter)
+    {
+        pool.parallel_for(shards, [&](std::size_t t)
+                          {
+            const auto start = std::chrono::steady_clock::now();
+            const std::size_t begin = n * t / shards;
+            shuffle_order(orders[t], blocks[t], shuffle_block_, gens[t]);
+            for (std::size_t i : orders[t])
+            {
+                sample(begin + i);
+            }
+            worker_stats_[t].samples += orders[t].size();
+            worker_stats_[t].seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(); });
+        if (report_iteration(iter))
+        {
+            report(iter);
+        }
+    }
+}
+
+void GradientDescent::hogwild_sgd(const CsrMatrix<double> &X, const std::vector<double> &y)
+{
+    if (family_ == GlmFamily::Softmax)
+    {
+        throw std::invalid_argument("GradientDescent: hogwild_sgd does not support the softmax family");
+    }
+    prepare_weights(X.rows(), X.cols(), y);
+    // 训练期间参数保存在原子变量中，relaxed 读写在 x86 上就是普通的加载和存储
+    std::vector<std::atomic<double>> w(X.cols());
+    for (std::size_t j = 0; j < w.size(); ++j)
+    {
+        w[j].store(weights_[j], std::memory_order_relaxed);
+    }
+    std::atomic<double> b(intercept_);
+    auto publish = [&]
+    {
+        for (std::size_t j = 0; j < w.size(); ++j)
+        {
+            weights_[j] = w[j].load(std::memory_order_relaxed);
         }
+        intercept_ = b.load(std::memory_order_relaxed);
+    };
 
-        double cost = compute_loss(data);
-        if (iter % 10 == 0)
+    run_hogwild(
+        X.rows(),
+        [&](std::size_t i)
+        {
+            const std::uint32_t *idx = X.row_indices(i);
+            const double *val = X.row_values(i);
+            const std::size_t nnz = X.row_nnz(i);
+            double eta = b.load(std::memory_order_relaxed);
+            for (std::size_t p = 0; p < nnz; ++p)
+            {
+                eta += val[p] * w[idx[p]].load(std::memory_order_relaxed);
+            }
+            const double step = learning_rate_ * family_residual(family_, eta, y[i]);
+            for (std::size_t p = 0; p < nnz; ++p)
+            {
+                w[idx[p]].store(w[idx[p]].load(std::memory_order_relaxed) - step * val[p], std::memory_order_relaxed);
+            }
+            b.store(b.load(std::memory_order_relaxed) - step, std::memory_order_relaxed);
+        },
+        [&](int iter)
         {
-            std::cout << "Iteration " << iter + 1 << ": Cost = " << cost << "\n";
+            publish();
+            std::cout << "Iteration " << iter + 1 << " loss: " << compute_loss(X, y) << std::endl;
+        });
+    publish();
+}
+
+void GradientDescent::hogwild_sgd(const MatrixView<double> &X, const std::vector<double> &y)
+{
+    if (family_ == GlmFamily::Softmax)
+    {
+        throw std::invalid_argument("GradientDescent: hogwild_sgd does not support the softmax family");
+    }
+    prepare_weights(X.rows(), X.cols(), y);
+    const std::size_t d = X.cols();
+    std::vector<std::atomic<double>> w(d);
+    for (std::size_t j = 0; j < d; ++j)
+    {
+        w[j].store(weights_[j], std::memory_order_relaxed);
+    }
+    std::atomic<double> b(intercept_);
+    auto publish = [&]
+    {
+        for (std::size_t j = 0; j < d; ++j)
+        {
+            weights_[j] = w[j].load(std::memory_order_relaxed);
         }
+        intercept_ = b.load(std::memory_order_relaxed);
+    };
+
+    run_hogwild(
+        X.rows(),
+        [&](std::size_t i)
+        {
+            double eta = b.load(std::memory_order_relaxed);
+            for (std::size_t j = 0; j < d; ++j)
+            {
+                eta += X(i, j) * w[j].load(std::memory_order_relaxed);
+            }
+            const double step = learning_rate_ * family_residual(family_, eta, y[i]);
+            for (std::size_t j = 0; j < d; ++j)
+            {
+                w[j].store(w[j].load(std::memory_order_relaxed) - step * X(i, j), std::memory_order_relaxed);
+            }
+            b.store(b.load(std::memory_order_relaxed) - step, std::memory_order_relaxed);
+        },
+        [&](int iter)
+        {
+            publish();
+            std::cout << "Iteration " << iter + 1 << " loss: " << compute_loss(X, y) << std::endl;
+        });
+    publish();
+}
+
+template <typename Rows>
+void GradientDescent::solve_rows(const Rows &rows, double *w, double &b)
+{
+    if (!(l2_ >= 0.0))
+    {
+        throw std::invalid_argument("GradientDescent: l2 must be non-negative");
     }
-}
\ No newline at end of file
+    const std::size_t n = rows.rows();
+    const std::size_t d = rows.cols();
+    ThreadPool pool(num_threads_);
+    Eigen::VectorXd theta(d + 1);
+    LeastSquaresSolver solver = solver_;
+    if (solver == LeastSquaresSolver::Auto && d + 2 > kMaxNormalDim)
+    {
+        solver = LeastSquaresSolver::LBFGS;
+    }
+
+    if (solver == LeastSquaresSolver::Auto || solver == LeastSquaresSolver::Cholesky)
+    {
+        if (cholesky_solve(accumulate_gram(rows, pool), n, l2_, theta))
+        {
+            solver = LeastSquaresSolver::Cholesky;
+        }
+        else if (solver == LeastSquaresSolver::Cholesky)
+        {
+            throw std::runtime_error("GradientDescent: normal equations are singular or ill-conditioned");
+        }
+        else
+        {
+            solver = LeastSquaresSolver::QR;
+        }
+    }
+    if (solver == LeastSquaresSolver::QR)
+    {
+        theta = qr_solve(accumulate_qr(rows, pool), n, l2_);
+    }
+    else if (solver == LeastSquaresSolver::LBFGS)
+    {
+        theta.head(d) = Eigen::Map<const Eigen::VectorXd>(w, d);
+        theta[d] = b;
+        lbfgs_solve(rows, pool, l2_, max_iterations_, tolerance_, theta, [&](int iter, double loss)
+                    {
+            if (report_iteration(iter))
+            {
+                std::cout << "Iteration " << iter + 1 << " loss: " << loss << std::endl;
+            } });
+    }
+    std::copy(theta.data(), theta.data() + d, w);
+    b = theta[d];
+}
+
+void GradientDescent::solve_least_squares(const std::vector<Point> &data)
+{
+    require_gaussian("solve_least_squares");
+    if (data.empty())
+    {
+        throw std::invalid_argument("GradientDescent: data must be non-empty");
+    }
+    solve_rows(PointRows{data}, &slope_, intercept_);
+}
+
+void GradientDescent::solve_least_squares(const CsrMatrix<double> &X, const std::vector<double> &y)
+{
+    require_gaussian("solve_least_squares");
+    prepare_weights(X.rows(), X.cols(), y);
+    solve_rows(SparseRows{X, y}, weights_.data(), intercept_);
+}
+
+void GradientDescent::solve_least_squares(const MatrixView<double> &X, const std::vector<double> &y)
+{
+    require_gaussian("solve_least_squares");
+    prepare_weights(X.rows(), X.cols(), y);
+    solve_rows(DenseRows{X, y}, weights_.data(), intercept_);
+}
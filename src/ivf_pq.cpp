@@ -0,0 +1,245 @@
+#include "ivf_pq.h"
+#include "distance.h"
+#include <algorithm>
+#include <limits>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+
+namespace
+{
+    // 残差、距离表与扫描都按平方欧氏距离计算，粗量化器与码本只能用欧氏度量训练。
+    // 索引内部的 KMeans 不输出训练过程
+    IVFPQOptions checked_options(const IVFPQOptions &options)
+    {
+        if (options.kmeans.metric != KMeansMetric::Euclidean &&
+            options.kmeans.metric != KMeansMetric::SquaredEuclidean)
+        {
+            throw std::invalid_argument("IVFPQIndex: kmeans.metric must be Euclidean or SquaredEuclidean");
+        }
+        IVFPQOptions checked = options;
+        checked.kmeans.verbose = false;
+        return checked;
+    }
+
+    // 训练子空间码本时使用的配置：与粗量化器相同，但种子按子空间编号错开
+    KMeansOptions subspace_options(const KMeansOptions &base, int s)
+    {
+        KMeansOptions options = base;
+        if (options.seed)
+        {
+            options.seed = *options.seed + static_cast<std::uint64_t>(s) + 1;
+        }
+        return options;
+    }
+}
+
+IVFPQIndex::IVFPQIndex(std::size_t dim, const IVFPQOptions &options)
+    : dim_(dim), dsub_(0), options_(checked_options(options)),
+      coarse_(options_.nlist, options_.train_iterations, options_.kmeans)
+{
+    if (dim_ == 0 || options_.m <= 0 || dim_ % options_.m != 0)
+    {
+        throw std::invalid_argument("IVFPQIndex: dim must be a positive multiple of m");
+    }
+    if (options_.nlist <= 0)
+    {
+        throw std::invalid_argument("IVFPQIndex: nlist must be positive");
+    }
+    dsub_ = dim_ / options_.m;
+}
+
+Matrix<float> IVFPQIndex::residuals(const MatrixView<float> &data, const std::vector<int> &assign) const
+{
+    Matrix<float> out(data.rows(), dim_);
+    for (std::size_t i = 0; i < data.rows(); ++i)
+    {
+        const float *center = coarse_centers_.row(assign[i]);
+        float *r = out.row(i);
+        for (std::size_t j = 0; j < dim_; ++j)
+        {
+            r[j] = data(i, j) - center[j];
+        }
+    }
+    return out;
+}
+
+void IVFPQIndex::train(const MatrixView<float> &data)
+{
+    if (data.cols() != dim_)
+    {
+        throw std::invalid_argument("IVFPQIndex::train: dimension mismatch");
+    }
+    coarse_.fit(data);
+    const Matrix<double> &centers = coarse_.get_centers();
+    coarse_centers_.resize(centers.rows(), dim_);
+    for (std::size_t i = 0; i < centers.rows() * dim_; ++i)
+    {
+        coarse_centers_.data()[i] = static_cast<float>(centers.data()[i]);
+    }
+
+    // 在残差上按子空间训练码本：残差矩阵的第 s 段列组成步长为 dim 的行优先子视图，不需要拷贝
+    const Matrix<float> res = residuals(data, coarse_.get_labels());
+    quantizers_.clear();
+    codebooks_.resize(options_.m * kCodebookSize, dsub_);
+    for (int s = 0; s < options_.m; ++s)
+    {
+        quantizers_.emplace_back(static_cast<int>(kCodebookSize), options_.train_iterations,
+                                 subspace_options(options_.kmeans, s));
+        KMeans &pq = quantizers_.back();
+        pq.fit(MatrixView<float>(res.data() + s * dsub_, res.rows(), dsub_, Layout::RowMajor, dim_));
+        const Matrix<double> &words = pq.get_centers();
+        for (std::size_t c = 0; c < kCodebookSize; ++c)
+        {
+            float *dst = codebooks_.row(s * kCodebookSize + c);
+            for (std::size_t j = 0; j < dsub_; ++j)
+            {
+                dst[j] = static_cast<float>(words(c, j));
+            }
+        }
+    }
+
+    lists_.assign(options_.nlist, InvertedList());
+    for (auto &list : lists_)
+    {
+        list.codes.resize(options_.m);
+    }
+    size_ = 0;
+    trained_ = true;
+}
+
+void IVFPQIndex::add(const MatrixView<float> &data, const std::vector<std::int64_t> &ids)
+{
+    if (!trained_)
+    {
+        throw std::logic_error("IVFPQIndex::add: index is not trained");
+    }
+    if (data.cols() != dim_)
+    {
+        throw std::invalid_argument("IVFPQIndex::add: dimension mismatch");
+    }
+    if (!ids.empty() && ids.size() != data.rows())
+    {
+        throw std::invalid_argument("IVFPQIndex::add: ids size does not match data");
+    }
+
+    const std::vector<int> assign = coarse_.predict(data);
+    const Matrix<float> res = residuals(data, assign);
+    std::vector<std::vector<int>> codes(options_.m);
+    for (int s = 0; s < options_.m; ++s)
+    {
+        codes[s] = quantizers_[s].predict(MatrixView<float>(res.data() + s * dsub_, res.rows(), dsub_,
+                                                            Layout::RowMajor, dim_));
+    }
+    for (std::size_t i = 0; i < data.rows(); ++i)
+    {
+        InvertedList &list = lists_[assign[i]];
+        list.ids.push_back(ids.empty() ? static_cast<std::int64_t>(size_ + i) : ids[i]);
+        for (int s = 0; s < options_.m; ++s)
+        {
+            list.codes[s].push_back(static_cast<std::uint8_t>(codes[s][i]));
+        }
+    }
+    size_ += data.rows();
+}
+
+void IVFPQIndex::compute_lut(const float *r, float *lut) const
+{
+    for (int s = 0; s < options_.m; ++s)
+    {
+        const float *sub = r + s * dsub_;
+        for (std::size_t c = 0; c < kCodebookSize; ++c)
+        {
+            lut[s * kCodebookSize + c] = simd::squared_l2(sub, codebooks_.row(s * kCodebookSize + c), dsub_);
+        }
+    }
+}
+
+void IVFPQIndex::search(const MatrixView<float> &queries, int k, std::vector<std::int64_t> &ids,
+                        std::vector<float> &distances) const
+{
+    if (!trained_)
+    {
+        throw std::logic_error("IVFPQIndex::search: index is not trained");
+    }
+    if (queries.cols() != dim_)
+    {
+        throw std::invalid_argument("IVFPQIndex::search: dimension mismatch");
+    }
+    if (k <= 0)
+    {
+        throw std::invalid_argument("IVFPQIndex::search: k must be positive");
+    }
+    const std::size_t nq = queries.rows();
+    const std::size_t nprobe = std::min<std::size_t>(std::max(1, options_.nprobe), options_.nlist);
+    ids.assign(nq * k, -1);
+    distances.assign(nq * k, std::numeric_limits<float>::infinity());
+
+    // 所有查询到粗中心的距离用分块内积一次算出
+    const Matrix<float> coarse_dist = coarse_.transform(queries);
+    std::vector<int> probes(options_.nlist);
+    AlignedVector<float> q(dim_);
+    AlignedVector<float> r(dim_);
+    AlignedVector<float> lut(options_.m * kCodebookSize);
+    std::vector<float> scores;
+    std::vector<const std::uint8_t *> code_ptrs(options_.m);
+    // 大顶堆保存当前最好的 k 个候选
+    std::priority_queue<std::pair<float, std::int64_t>> heap;
+
+    for (std::size_t qi = 0; qi < nq; ++qi)
+    {
+        const float *dist = coarse_dist.row(qi);
+        for (int c = 0; c < options_.nlist; ++c)
+        {
+            probes[c] = c;
+        }
+        std::partial_sort(probes.begin(), probes.begin() + nprobe, probes.end(), [&](int a, int b)
+                          { return dist[a] < dist[b] || (dist[a] == dist[b] && a < b); });
+        for (std::size_t j = 0; j < dim_; ++j)
+        {
+            q[j] = queries(qi, j);
+        }
+
+        for (std::size_t p = 0; p < nprobe; ++p)
+        {
+            const InvertedList &list = lists_[probes[p]];
+            const std::size_t len = list.ids.size();
+            if (len == 0)
+            {
+                continue;
+            }
+            const float *center = coarse_centers_.row(probes[p]);
+            for (std::size_t j = 0; j < dim_; ++j)
+            {
+                r[j] = q[j] - center[j];
+            }
+            compute_lut(r.data(), lut.data());
+            for (int s = 0; s < options_.m; ++s)
+            {
+                code_ptrs[s] = list.codes[s].data();
+            }
+            scores.resize(len);
+            simd::pq_scan(lut.data(), kCodebookSize, code_ptrs.data(), options_.m, len, scores.data());
+            for (std::size_t i = 0; i < len; ++i)
+            {
+                if (heap.size() < static_cast<std::size_t>(k))
+                {
+                    heap.emplace(scores[i], list.ids[i]);
+                }
+                else if (scores[i] < heap.top().first)
+                {
+                    heap.pop();
+                    heap.emplace(scores[i], list.ids[i]);
+                }
+            }
+        }
+
+        // 堆顶是最远的候选，倒序写出得到升序结果
+        for (std::size_t slot = heap.size(); slot > 0; --slot)
+        {
+            ids[qi * k + slot - 1] = heap.top().second;
+            distances[qi * k + slot - 1] = heap.top().first;
+            heap.pop();
+        }
+    }
+}
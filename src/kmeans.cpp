@@ -1,110 +1,898 @@
 #include "kmeans.h"
+#include "distance.h"
+#include "thread_pool.h"
+#include "mapped_file.h"
+#include "kd_tree.h"
+#include "metric.h"
+#include "sparse.h"
+#include <atomic>
+#include <deque>
 #include <iostream>
+#include <limits>
+#include <mutex>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_set>
+
+namespace
+{
+    // 列优先数据按块分配时每块包含的样本数
+    constexpr std::size_t kColBlock = 256;
+    // 并行分配时每个任务处理的样本数
+    constexpr std::size_t kAssignGrain = 1024;
+    // predict / transform 分块计算内积时每块的查询数和中心数
+    constexpr std::size_t kPredictRows = 64;
+    constexpr std::size_t kPredictCenters = 256;
+    // 内存映射数据每次处理的字节数，以及初始化时抽样的最少行数
+    constexpr std::size_t kMappedBlockBytes = std::size_t(64) << 20;
+    constexpr std::size_t kMappedInitSample = 65536;
+    // 归约切片的最小样本数和最大个数
+    constexpr std::size_t kMinSliceRows = 4096;
+    constexpr std::size_t kMaxSlices = 64;
+    // 所有切片的部分和合计占用内存的上限（字节）
+    constexpr std::size_t kSliceBudget = std::size_t(256) << 20;
+
+    // 归约切片：把 n 个样本划分为 count 段连续区间，每段在一个任务内顺序累加部分和，
+    // 再按切片编号顺序合并。划分只依赖 n、k、d，与线程数无关，因此结果逐位一致
+    struct SlicePlan
+    {
+        std::size_t n;
+        std::size_t count;
+
+        std::size_t begin(std::size_t s) const { return n * s / count; }
+        std::size_t end(std::size_t s) const { return n * (s + 1) / count; }
+    };
+
+    SlicePlan plan_slices(std::size_t n, std::size_t k, std::size_t d)
+    {
+        std::size_t count = std::min(kMaxSlices, std::max<std::size_t>(1, n / kMinSliceRows));
+        const std::size_t per_slice = std::max<std::size_t>(1, k * (d + 1) * sizeof(double));
+        count = std::max<std::size_t>(1, std::min(count, kSliceBudget / per_slice));
+        return SlicePlan{n, count};
+    }
+
+    // splitmix64：从一个种子派生出互不相关的子种子，保证按块采样与线程数无关
+    inline std::uint64_t mix_seed(std::uint64_t x)
+    {
+        x += 0x9e3779b97f4a7c15ULL;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+
+    // 把第 i 个样本复制到连续缓冲区（列优先视图中样本不连续）
+    template <typename T>
+    inline void copy_row(const MatrixView<T> &data, std::size_t i, T *out)
+    {
+        for (std::size_t j = 0; j < data.cols(); ++j)
+        {
+            out[j] = data(i, j);
+        }
+    }
+
+    // 按权重采样一个下标：先用分块和定位块，再在块内定位。块按固定大小划分，结果与线程数无关
+    std::size_t sample_weighted(const std::vector<double> &weights, const std::vector<double> &block_sums,
+                                std::size_t grain, double r)
+    {
+        std::size_t b = 0;
+        for (; b + 1 < block_sums.size() && r >= block_sums[b]; ++b)
+        {
+            r -= block_sums[b];
+        }
+        const std::size_t begin = b * grain;
+        const std::size_t end = std::min(weights.size(), begin + grain);
+        std::size_t last = begin;
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            if (weights[i] > 0.0)
+            {
+                last = i;
+                if (r < weights[i])
+                {
+                    return i;
+                }
+                r -= weights[i];
+            }
+        }
+        // 浮点误差导致越界时返回块内最后一个权重为正的样本
+        return last;
+    }
+
+    // 行优先时直接返回第 i 行，否则把样本复制到 buffer 后返回
+    template <typename T>
+    inline const T *contiguous_row(const MatrixView<T> &data, std::size_t i, T *buffer)
+    {
+        if (data.row_major())
+        {
+            return data.row(i);
+        }
+        copy_row(data, i, buffer);
+        return buffer;
+    }
+
+    // rows 所指样本中互不相同的个数，达到 limit 时返回 limit。按字典序排序下标副本后数相邻的不同行
+    template <typename T>
+    std::size_t count_distinct_rows(const MatrixView<T> &data, std::vector<std::size_t> rows, std::size_t limit)
+    {
+        const std::size_t d = data.cols();
+        auto compare = [&](std::size_t a, std::size_t b)
+        {
+            for (std::size_t j = 0; j < d; ++j)
+            {
+                if (data(a, j) != data(b, j))
+                {
+                    return data(a, j) < data(b, j) ? -1 : 1;
+                }
+            }
+            return 0;
+        };
+        std::sort(rows.begin(), rows.end(), [&](std::size_t a, std::size_t b)
+                  { return compare(a, b) < 0; });
+        std::size_t distinct = rows.empty() ? 0 : 1;
+        for (std::size_t r = 1; r < rows.size() && distinct < limit; ++r)
+        {
+            distinct += compare(rows[r - 1], rows[r]) != 0;
+        }
+        return std::min(distinct, limit);
+    }
+
+    // Floyd 算法：O(k) 次随机数从 [0, n) 中不放回地抽取 k 个下标（k <= n），按抽取顺序返回。
+    // 已选下标放在哈希集合中，去重检查为 O(1)，总代价 O(k)
+    template <typename Rng>
+    std::vector<std::size_t> sample_distinct(std::size_t n, std::size_t k, Rng &rng)
+    {
+        std::vector<std::size_t> picked;
+        picked.reserve(k);
+        std::unordered_set<std::size_t> seen;
+        seen.reserve(k);
+        for (std::size_t j = n - k; j < n; ++j)
+        {
+            std::size_t t = std::uniform_int_distribution<std::size_t>(0, j)(rng);
+            if (!seen.insert(t).second)
+            {
+                t = j;
+                seen.insert(t);
+            }
+            picked.push_back(t);
+        }
+        return picked;
+    }
+
+    // 由平方范数得到 1 / ||x||，零向量返回 0（在球面 KMeans 的更新中不起作用）
+    inline double inverse_norm(double squared_norm)
+    {
+        return squared_norm > 0.0 ? 1.0 / std::sqrt(squared_norm) : 0.0;
+    }
+
+    // 按运行时配置的度量选择编译期策略，fn 以策略对象为参数调用一次
+    template <typename F>
+    decltype(auto) dispatch_metric(KMeansMetric m, F &&fn)
+    {
+        switch (m)
+        {
+        case KMeansMetric::SquaredEuclidean:
+            return fn(metric::SquaredEuclidean());
+        case KMeansMetric::Manhattan:
+            return fn(metric::Manhattan());
+        case KMeansMetric::Cosine:
+            return fn(metric::Cosine());
+        default:
+            return fn(metric::Euclidean());
+        }
+    }
+
+    // KD 树过滤算法（Kanungo 等）一次遍历的上下文：每个并行任务各持有一份部分和与计数
+    template <typename T>
+    struct FilterPass
+    {
+        const KDTree<T> &tree;
+        const MatrixView<T> &data;
+        const Matrix<double> &centers;
+        const Matrix<T> &point_centers;
+        Matrix<double> &sums;
+        std::vector<std::size_t> &counts;
+        // 非空时同时写出每个样本的标签
+        int *labels;
+        // 每一层递归使用的候选中心缓冲区；deque 扩容时不会使上层持有的引用失效
+        std::deque<std::vector<int>> candidates;
+        std::vector<double> midpoint;
+    };
+
+    // 把整棵子树（或一个样本）归入中心 c
+    template <typename T>
+    void filter_assign_node(FilterPass<T> &pass, int node, int c)
+    {
+        const auto &info = pass.tree.nodes()[node];
+        const double *s = pass.tree.sum(node);
+        double *acc = pass.sums.row(c);
+        for (std::size_t j = 0; j < pass.tree.dims(); ++j)
+        {
+            acc[j] += s[j];
+        }
+        pass.counts[c] += info.count();
+        if (pass.labels)
+        {
+            for (std::size_t p = info.begin; p < info.end; ++p)
+            {
+                pass.labels[pass.tree.indices()[p]] = c;
+            }
+        }
+    }
+
+    // 过滤一个节点：先找离包围盒中点最近的候选 z*，再剔除对盒内所有点都不如 z* 近的候选。
+    // 判定方法：取盒子在 z - z* 方向上最远的顶点 v，若 ||z - v|| >= ||z* - v||，则 z 对整个盒子都被 z* 支配。
+    // 只剩一个候选时整棵子树直接使用缓存的坐标和归入该中心
+    template <typename T>
+    void filter_node(FilterPass<T> &pass, int node, const std::vector<int> &cand, std::size_t depth)
+    {
+        const auto &info = pass.tree.nodes()[node];
+        const std::size_t d = pass.tree.dims();
+        if (cand.size() == 1)
+        {
+            filter_assign_node(pass, node, cand[0]);
+            return;
+        }
+        if (info.is_leaf())
+        {
+            for (std::size_t p = info.begin; p < info.end; ++p)
+            {
+                const std::size_t i = pass.tree.indices()[p];
+                T best = std::numeric_limits<T>::max();
+                int label = cand[0];
+                for (int c : cand)
+                {
+                    T dist = simd::squared_l2(pass.data, i, pass.point_centers.row(c));
+                    if (dist < best)
+                    {
+                        best = dist;
+                        label = c;
+                    }
+                }
+                double *acc = pass.sums.row(label);
+                for (std::size_t j = 0; j < d; ++j)
+                {
+                    acc[j] += pass.data(i, j);
+                }
+                pass.counts[label]++;
+                if (pass.labels)
+                {
+                    pass.labels[i] = label;
+                }
+            }
+            return;
+        }
+
+        const double *lo = pass.tree.lower(node);
+        const double *hi = pass.tree.upper(node);
+        for (std::size_t j = 0; j < d; ++j)
+        {
+            pass.midpoint[j] = 0.5 * (lo[j] + hi[j]);
+        }
+        int star = cand[0];
+        double star_dist = std::numeric_limits<double>::max();
+        for (int c : cand)
+        {
+            double dist = simd::squared_l2(pass.midpoint.data(), pass.centers.row(c), d);
+            if (dist < star_dist)
+            {
+                star_dist = dist;
+                star = c;
+            }
+        }
+
+        if (pass.candidates.size() <= depth)
+        {
+            pass.candidates.resize(depth + 1);
+        }
+        std::vector<int> &kept = pass.candidates[depth];
+        kept.clear();
+        kept.push_back(star);
+        const double *zs = pass.centers.row(star);
+        for (int c : cand)
+        {
+            if (c == star)
+            {
+                continue;
+            }
+            const double *z = pass.centers.row(c);
+            double to_z = 0.0;
+            double to_star = 0.0;
+            for (std::size_t j = 0; j < d; ++j)
+            {
+                const double v = z[j] > zs[j] ? hi[j] : lo[j];
+                to_z += (z[j] - v) * (z[j] - v);
+                to_star += (zs[j] - v) * (zs[j] - v);
+            }
+            if (to_z < to_star)
+            {
+                kept.push_back(c);
+            }
+        }
+        filter_node(pass, info.left, kept, depth + 1);
+        filter_node(pass, info.right, kept, depth + 1);
+    }
+}
 
 // 定义KMeans类的构造函数
-KMeans::KMeans(int k, int max_iterations)
+KMeans::KMeans(int k, int max_iterations, const KMeansOptions &options)
     // 初始化列表，用于在构造函数中直接初始化成员变量
-    : k_(k), max_iterations_(max_iterations) {}
+    : k_(k), max_iterations_(max_iterations), options_(options) {}
+
+ThreadPool &KMeans::pool()
+{
+    const int threads = ThreadPool::resolve(options_.num_threads);
+    if (!pool_ || pool_->size() != threads)
+    {
+        pool_ = std::make_shared<ThreadPool>(threads);
+    }
+    return *pool_;
+}
+
+template <typename T>
+const Matrix<T> &KMeans::working_centers() const
+{
+    if constexpr (std::is_same_v<T, float>)
+    {
+        return centers_f_;
+    }
+    else
+    {
+        return centers_;
+    }
+}
 
-// 定义KMeans类的distance方法，用于计算两个点之间的欧几里得距离
-double KMeans::distance(const Point &a, const Point &b) const
+template <typename T>
+const std::vector<T> &KMeans::working_norms() const
 {
-    return std::sqrt(std::pow(a.x - b.x, 2) + std::pow(a.y - b.y, 2));
+    if constexpr (std::is_same_v<T, float>)
+    {
+        return center_norms_f_;
+    }
+    else
+    {
+        return center_norms_;
+    }
+}
+
+// 把双精度中心同步到单精度副本，并缓存两种精度下每个中心的 ||c||^2
+void KMeans::sync_centers()
+{
+    centers_f_.resize(centers_.rows(), centers_.cols());
+    const double *src = centers_.data();
+    float *dst = centers_f_.data();
+    for (std::size_t i = 0; i < centers_.rows() * centers_.cols(); ++i)
+    {
+        dst[i] = static_cast<float>(src[i]);
+    }
+    center_norms_.resize(centers_.rows());
+    center_norms_f_.resize(centers_.rows());
+    for (std::size_t c = 0; c < centers_.rows(); ++c)
+    {
+        center_norms_[c] = simd::dot(centers_.row(c), centers_.row(c), centers_.cols());
+        center_norms_f_[c] = simd::dot(centers_f_.row(c), centers_f_.row(c), centers_f_.cols());
+    }
 }
 
 // KMeans类的成员函数，用于初始化聚类中心
-void KMeans::initialize_centers(const std::vector<Point> &data)
-{
-    // 创建一个随机设备，用于生成随机数种子
-    std::random_device rd;
-    // 使用随机设备生成一个梅森旋转引擎的随机数生成器
-    std::mt19937 gen(rd());
-    // 创建一个均匀整数分布，范围是从0到数据点数量的最后一个索引
-    std::uniform_int_distribution<> dis(0, data.size() - 1);
-
-    // 清空当前的聚类中心集合
-    centers_.clear();
-    // 循环k次，生成k个随机索引，并将对应的点作为初始聚类中心
+template <typename T>
+void KMeans::initialize_centers(const MatrixView<T> &data)
+{
+    // 设置了种子时结果可复现，否则使用随机设备生成种子
+    rng_.seed(options_.seed ? *options_.seed : std::random_device{}());
+    centers_.resize(k_, data.cols());
+    switch (options_.init)
+    {
+    case KMeansInit::Random:
+        init_random(data);
+        break;
+    case KMeansInit::KMeansParallel:
+        // 带权重的数据（如 coreset）通常很小，直接用加权 k-means++
+        if (sample_weights_)
+        {
+            init_plus_plus(data);
+        }
+        else
+        {
+            init_parallel(data);
+        }
+        break;
+    default:
+        init_plus_plus(data);
+        break;
+    }
+    sync_centers();
+}
+
+// 均匀随机选取 k 个不同的样本作为初始中心（样本数不足 k 时允许重复）
+template <typename T>
+void KMeans::init_random(const MatrixView<T> &data)
+{
+    const std::size_t n = data.rows();
+    const std::size_t d = data.cols();
+    std::vector<std::size_t> picked;
+    if (n >= static_cast<std::size_t>(k_))
+    {
+        picked = sample_distinct(n, static_cast<std::size_t>(k_), rng_);
+    }
+    else
+    {
+        std::uniform_int_distribution<std::size_t> dis(0, n - 1);
+        for (int i = 0; i < k_; ++i)
+        {
+            picked.push_back(dis(rng_));
+        }
+    }
     for (int i = 0; i < k_; ++i)
     {
-        // 生成一个随机索引
-        // 将数据中对应索引的点添加到聚类中心集合中
-        centers_.push_back(data[dis(gen)]);
+        for (std::size_t j = 0; j < d; ++j)
+        {
+            centers_(i, j) = static_cast<double>(data(picked[i], j));
+        }
+    }
+}
+
+// k-means++：第一个中心均匀选取，之后每个中心按 D(x)^2 加权采样，D(x) 为到已选中心的最近距离。
+// 有样本权重时第一个中心按 w 采样，之后按 w·D(x)^2 采样
+template <typename T>
+void KMeans::init_plus_plus(const MatrixView<T> &data)
+{
+    const std::size_t n = data.rows();
+    const std::size_t d = data.cols();
+    const std::size_t blocks = (n + kAssignGrain - 1) / kAssignGrain;
+    std::vector<double> min_dist(n, std::numeric_limits<double>::infinity());
+    std::vector<double> block_sums(blocks, 0.0);
+    AlignedVector<T> center(d);
+    // 采样质量：无权重时就是 min_dist，有权重时为 w·min_dist
+    std::vector<double> weighted_dist(sample_weights_ ? n : 0);
+    std::vector<double> &mass = sample_weights_ ? weighted_dist : min_dist;
+
+    std::size_t idx = std::uniform_int_distribution<std::size_t>(0, n - 1)(rng_);
+    if (sample_weights_)
+    {
+        const std::vector<double> weights(sample_weights_, sample_weights_ + n);
+        double total = 0.0;
+        for (double w : weights)
+        {
+            total += w;
+        }
+        idx = sample_weighted(weights, {total}, n, std::uniform_real_distribution<double>(0.0, total)(rng_));
+    }
+    for (int c = 0; c < k_; ++c)
+    {
+        copy_row(data, idx, center.data());
+        for (std::size_t j = 0; j < d; ++j)
+        {
+            centers_(c, j) = static_cast<double>(center[j]);
+        }
+        if (c + 1 == k_)
+        {
+            break;
+        }
+
+        // 并行更新每个样本到已选中心的最近距离，并按固定块求和
+        pool().parallel_for(blocks, [&](std::size_t b)
+                            {
+            const std::size_t end = std::min(n, (b + 1) * kAssignGrain);
+            double sum = 0.0;
+            for (std::size_t i = b * kAssignGrain; i < end; ++i)
+            {
+                const double dist = simd::squared_l2(data, i, center.data());
+                if (dist < min_dist[i])
+                {
+                    min_dist[i] = dist;
+                }
+                if (sample_weights_)
+                {
+                    weighted_dist[i] = sample_weights_[i] * min_dist[i];
+                }
+                sum += mass[i];
+            }
+            block_sums[b] = sum; });
+
+        double total = 0.0;
+        for (double sum : block_sums)
+        {
+            total += sum;
+        }
+        if (total > 0.0)
+        {
+            idx = sample_weighted(mass, block_sums, kAssignGrain,
+                                  std::uniform_real_distribution<double>(0.0, total)(rng_));
+        }
+        else
+        {
+            // 所有样本都与已选中心重合，只能均匀选取
+            idx = std::uniform_int_distribution<std::size_t>(0, n - 1)(rng_);
+        }
+    }
+}
+
+// k-means||：先均匀选一个中心，之后每轮以概率 min(1, l*D(x)^2/psi) 独立采样每个样本（l = oversampling*k），
+// 得到约 l*rounds 个候选；再按每个候选吸引的样本数加权，在候选集上做 k-means++ 和少量加权 Lloyd 迭代得到 k 个中心
+template <typename T>
+void KMeans::init_parallel(const MatrixView<T> &data)
+{
+    const std::size_t n = data.rows();
+    const std::size_t d = data.cols();
+    const std::size_t blocks = (n + kAssignGrain - 1) / kAssignGrain;
+    const double l = options_.oversampling * k_;
+
+    // 候选中心按行连续存放
+    AlignedVector<T> candidates(d);
+    copy_row(data, std::uniform_int_distribution<std::size_t>(0, n - 1)(rng_), candidates.data());
+    std::vector<double> min_dist(n, std::numeric_limits<double>::infinity());
+    std::vector<double> block_sums(blocks, 0.0);
+
+    // 用第 first 个及之后的候选更新最近距离，返回 psi = sum D(x)^2
+    auto update_min_dist = [&](std::size_t first)
+    {
+        const std::size_t m = candidates.size() / d;
+        pool().parallel_for(blocks, [&](std::size_t b)
+                            {
+            const std::size_t end = std::min(n, (b + 1) * kAssignGrain);
+            double sum = 0.0;
+            for (std::size_t i = b * kAssignGrain; i < end; ++i)
+            {
+                for (std::size_t c = first; c < m; ++c)
+                {
+                    min_dist[i] = std::min<double>(min_dist[i], simd::squared_l2(data, i, candidates.data() + c * d));
+                }
+                sum += min_dist[i];
+            }
+            block_sums[b] = sum; });
+        double psi = 0.0;
+        for (double sum : block_sums)
+        {
+            psi += sum;
+        }
+        return psi;
+    };
+
+    double psi = update_min_dist(0);
+    std::vector<std::vector<std::size_t>> block_picks(blocks);
+    for (int round = 0; round < options_.init_rounds && psi > 0.0; ++round)
+    {
+        // 每个块使用由 (轮种子, 块号) 派生的独立随机流，采样结果与线程数无关
+        const std::uint64_t round_seed = rng_();
+        pool().parallel_for(blocks, [&](std::size_t b)
+                            {
+            std::mt19937_64 gen(mix_seed(round_seed ^ mix_seed(b)));
+            std::uniform_real_distribution<double> uniform(0.0, 1.0);
+            block_picks[b].clear();
+            const std::size_t end = std::min(n, (b + 1) * kAssignGrain);
+            for (std::size_t i = b * kAssignGrain; i < end; ++i)
+            {
+                if (uniform(gen) < l * min_dist[i] / psi)
+                {
+                    block_picks[b].push_back(i);
+                }
+            } });
+
+        const std::size_t first = candidates.size() / d;
+        for (const auto &picks : block_picks)
+        {
+            for (std::size_t i : picks)
+            {
+                candidates.resize(candidates.size() + d);
+                copy_row(data, i, candidates.data() + candidates.size() - d);
+            }
+        }
+        psi = update_min_dist(first);
+    }
+
+    const std::size_t m = candidates.size() / d;
+    if (m <= static_cast<std::size_t>(k_))
+    {
+        // 候选数量不足（数据量很小或大量重复点），退回到 k-means++
+        init_plus_plus(data);
+        return;
+    }
+
+    // 统计每个候选吸引的样本数作为权重，按切片计数再合并
+    const SlicePlan plan = plan_slices(n, m, 0);
+    std::vector<std::vector<double>> partial(plan.count);
+    pool().parallel_for(plan.count, [&](std::size_t s)
+                        {
+        partial[s].assign(m, 0.0);
+        for (std::size_t i = plan.begin(s); i < plan.end(s); ++i)
+        {
+            T best = std::numeric_limits<T>::max();
+            std::size_t arg = 0;
+            for (std::size_t c = 0; c < m; ++c)
+            {
+                T dist = simd::squared_l2(data, i, candidates.data() + c * d);
+                if (dist < best)
+                {
+                    best = dist;
+                    arg = c;
+                }
+            }
+            partial[s][arg] += 1.0;
+        } });
+    std::vector<double> weights(m, 0.0);
+    for (const auto &counts : partial)
+    {
+        for (std::size_t c = 0; c < m; ++c)
+        {
+            weights[c] += counts[c];
+        }
+    }
+
+    // 在加权候选集上做 k-means++
+    std::vector<double> cand_dist(m, std::numeric_limits<double>::infinity());
+    std::vector<double> cand_blocks(1, 0.0);
+    std::size_t idx = sample_weighted(weights, {static_cast<double>(n)}, m,
+                                      std::uniform_real_distribution<double>(0.0, static_cast<double>(n))(rng_));
+    for (int c = 0; c < k_; ++c)
+    {
+        const T *center = candidates.data() + idx * d;
+        for (std::size_t j = 0; j < d; ++j)
+        {
+            centers_(c, j) = static_cast<double>(center[j]);
+        }
+        if (c + 1 == k_)
+        {
+            break;
+        }
+        std::vector<double> scores(m);
+        double total = 0.0;
+        for (std::size_t i = 0; i < m; ++i)
+        {
+            cand_dist[i] = std::min<double>(cand_dist[i], simd::squared_l2(candidates.data() + i * d, center, d));
+            scores[i] = weights[i] * cand_dist[i];
+            total += scores[i];
+        }
+        if (total <= 0.0)
+        {
+            idx = std::uniform_int_distribution<std::size_t>(0, m - 1)(rng_);
+            continue;
+        }
+        cand_blocks[0] = total;
+        idx = sample_weighted(scores, cand_blocks, m, std::uniform_real_distribution<double>(0.0, total)(rng_));
+    }
+
+    // 少量加权 Lloyd 迭代细化候选集上的中心
+    constexpr int kRefineIterations = 10;
+    std::vector<int> cand_labels(m);
+    Matrix<double> sums(k_, d);
+    std::vector<double> mass(k_);
+    AlignedVector<double> cand_row(d);
+    for (int iter = 0; iter < kRefineIterations; ++iter)
+    {
+        pool().parallel_for_blocks(m, kAssignGrain, [&](std::size_t begin, std::size_t end)
+                                   {
+            AlignedVector<double> row(d);
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                for (std::size_t j = 0; j < d; ++j)
+                {
+                    row[j] = candidates[i * d + j];
+                }
+                double best = std::numeric_limits<double>::max();
+                for (int c = 0; c < k_; ++c)
+                {
+                    double dist = simd::squared_l2(row.data(), centers_.row(c), d);
+                    if (dist < best)
+                    {
+                        best = dist;
+                        cand_labels[i] = c;
+                    }
+                }
+            } });
+        sums.resize(k_, d, 0.0);
+        mass.assign(k_, 0.0);
+        for (std::size_t i = 0; i < m; ++i)
+        {
+            double *acc = sums.row(cand_labels[i]);
+            for (std::size_t j = 0; j < d; ++j)
+            {
+                acc[j] += weights[i] * candidates[i * d + j];
+            }
+            mass[cand_labels[i]] += weights[i];
+        }
+        for (int c = 0; c < k_; ++c)
+        {
+            if (mass[c] > 0.0)
+            {
+                for (std::size_t j = 0; j < d; ++j)
+                {
+                    centers_(c, j) = sums(c, j) / mass[c];
+                }
+            }
+        }
     }
 }
 
 // KMeans类的成员函数，用于将数据点分配到最近的聚类中心
-void KMeans::assign_clusters(const std::vector<Point> &data)
+template <typename T>
+void KMeans::assign_clusters(const MatrixView<T> &data)
 {
+    const std::size_t n = data.rows();
+    const std::size_t d = data.cols();
+    const Matrix<T> &centers = working_centers<T>();
     // 调整labels_的大小以匹配数据点的数量
-    labels_.resize(data.size());
-    // 遍历每个数据点
-    for (size_t i = 0; i < data.size(); ++i)
+    labels_.resize(n);
+
+    if (data.row_major())
     {
-        // 初始化最小距离为最大可能的double值
-        double min_dist = std::numeric_limits<double>::max();
-        // 初始化聚类标签为-1（表示未分配）
-        int cluster = -1;
+        // 行优先：每个样本连续，逐个样本与所有中心比较平方距离（不需要开方）
+        pool().parallel_for_blocks(n, kAssignGrain, [&](std::size_t begin, std::size_t end)
+                                   {
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                const T *x = data.row(i);
+                T min_dist = std::numeric_limits<T>::max();
+                int cluster = 0;
+                for (int j = 0; j < k_; ++j)
+                {
+                    T dist = simd::squared_l2(x, centers.row(j), d);
+                    if (dist < min_dist)
+                    {
+                        min_dist = dist;
+                        cluster = j;
+                    }
+                }
+                labels_[i] = cluster;
+            } });
+        return;
+    }
 
-        // 遍历每个聚类中心
+    // 列优先：按样本块处理，对每个中心一次算出整块样本的距离
+    pool().parallel_for_blocks(n, kColBlock, [&](std::size_t begin, std::size_t end)
+                               {
+        const std::size_t len = end - begin;
+        T block_dist[kColBlock];
+        T block_min[kColBlock];
+        std::fill(block_min, block_min + len, std::numeric_limits<T>::max());
         for (int j = 0; j < k_; ++j)
         {
-            // 计算当前数据点到当前聚类中心的距离
-            double dist = distance(data[i], centers_[j]);
-            // 如果当前距离小于已知的最小距离，则更新最小距离和聚类标签
-            if (dist < min_dist)
+            simd::squared_l2_colmajor(data.data() + begin, data.ld(), len, centers.row(j), d, block_dist);
+            for (std::size_t i = 0; i < len; ++i)
+            {
+                if (block_dist[i] < block_min[i])
+                {
+                    block_min[i] = block_dist[i];
+                    labels_[begin + i] = j;
+                }
+            }
+        } });
+}
+
+// 按 labels_ 把样本累加到各自的簇：每个切片各自累加部分和，再按切片编号顺序合并，结果与线程数无关。
+// 设置了样本权重时累加 w·x 和 w，counts 为每个簇的总权重（无权重时即样本数）
+template <typename T>
+void KMeans::accumulate_clusters(const MatrixView<T> &data, Matrix<double> &sums, std::vector<double> &counts,
+                                 const double *row_scale)
+{
+    const std::size_t n = data.rows();
+    const std::size_t d = data.cols();
+    const SlicePlan plan = plan_slices(n, k_, d);
+    const double *weights = sample_weights_;
+    // 每个切片各自的部分和（k_×d）与计数（k_）
+    std::vector<Matrix<double>> partial_sums(plan.count);
+    std::vector<std::vector<double>> partial_counts(plan.count);
+
+    pool().parallel_for(plan.count, [&](std::size_t s)
+                        {
+        Matrix<double> &acc_sums = partial_sums[s];
+        std::vector<double> &acc_counts = partial_counts[s];
+        acc_sums.resize(k_, d, 0.0);
+        acc_counts.assign(k_, 0.0);
+        const std::size_t begin = plan.begin(s);
+        const std::size_t end = plan.end(s);
+        if (data.row_major())
+        {
+            // 遍历切片中的每个点，将坐标累加到对应聚类中
+            for (std::size_t i = begin; i < end; ++i)
             {
-                min_dist = dist;
-                cluster = j;
+                const T *x = data.row(i);
+                const double w = weights ? weights[i] : 1.0;
+                const double scaled = row_scale ? w * row_scale[i] : w;
+                double *acc = acc_sums.row(labels_[i]);
+                for (std::size_t j = 0; j < d; ++j)
+                {
+                    acc[j] += scaled * x[j];
+                }
+                acc_counts[labels_[i]] += w;
             }
         }
-        // 将当前数据点的聚类标签设置为最近的聚类中心
-        labels_[i] = cluster;
-    }
+        else
+        {
+            // 列优先：按特征逐列累加，保证顺序访问内存
+            for (std::size_t j = 0; j < d; ++j)
+            {
+                const T *col = data.col(j);
+                for (std::size_t i = begin; i < end; ++i)
+                {
+                    acc_sums(labels_[i], j) += (weights ? weights[i] : 1.0) * (row_scale ? row_scale[i] : 1.0) * col[i];
+                }
+            }
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                acc_counts[labels_[i]] += weights ? weights[i] : 1.0;
+            }
+        } });
+
+    // 按切片编号顺序合并部分和，不同中心之间相互独立，可以并行
+    sums.resize(k_, d, 0.0);
+    counts.assign(k_, 0.0);
+    pool().parallel_for(k_, [&](std::size_t c)
+                        {
+        double *total = sums.row(c);
+        for (std::size_t s = 0; s < plan.count; ++s)
+        {
+            counts[c] += partial_counts[s][c];
+            const double *acc = partial_sums[s].row(c);
+            for (std::size_t j = 0; j < d; ++j)
+            {
+                total[j] += acc[j];
+            }
+        } });
 }
 
 // KMeans类的成员函数，用于更新聚类中心
-void KMeans::update_centers(const std::vector<Point> &data)
+template <typename T>
+void KMeans::update_centers(const MatrixView<T> &data, const double *row_scale)
 {
-    // 创建一个大小为k_的整数向量，用于记录每个聚类的点数，初始值为0
-    std::vector<int> counts(k_, 0);
-    // 创建一个大小为k_的点向量，用于存储新的聚类中心，初始值为(0, 0)
-    std::vector<Point> new_centers(k_, {0, 0});
+    const std::size_t d = data.cols();
+    Matrix<double> sums;
+    std::vector<double> counts;
+    accumulate_clusters(data, sums, counts, row_scale);
 
-    // 遍历数据集中的每个点
-    for (size_t i = 0; i < data.size(); ++i)
+    for (int c = 0; c < k_; ++c)
     {
-        // 获取当前点所属的聚类标签
-        int cluster = labels_[i];
-        // 将当前点的坐标累加到对应聚类中心的新坐标中
-        new_centers[cluster].x += data[i].x;
-        new_centers[cluster].y += data[i].y;
-        // 对应聚类的点数加1
-        counts[cluster]++;
+        // 有点的簇取（加权）均值作为新中心，空簇保持原中心
+        if (counts[c] == 0.0)
+        {
+            continue;
+        }
+        for (std::size_t j = 0; j < d; ++j)
+        {
+            centers_(c, j) = sums(c, j) / counts[c];
+        }
     }
+    // 记录每个簇的样本数（总权重），之后的 partial_fit 以此作为学习率的起点
+    center_counts_ = counts;
+    sync_centers();
+}
 
-    // 遍历每个聚类
-    for (int i = 0; i < k_; ++i)
+// 小批量更新：中心 c 的学习率为 m_c / (v_c + m_c)，m_c 为本批分到 c 的样本数，v_c 为此前累计的样本数。
+// 这等价于依次对每个样本做 c += (x - c) / v_c 的逐点更新，但可以并行、确定性地累加
+template <typename T>
+void KMeans::minibatch_step(const MatrixView<T> &data)
+{
+    const std::size_t d = data.cols();
+    assign_clusters(data);
+    Matrix<double> sums;
+    std::vector<double> counts;
+    accumulate_clusters(data, sums, counts);
+
+    for (int c = 0; c < k_; ++c)
     {
-        // 如果当前聚类中有点
-        if (counts[i] > 0)
+        if (counts[c] == 0)
         {
-            // 计算新的聚类中心坐标，即累加的坐标除以点数
-            centers_[i].x = new_centers[i].x / counts[i];
-            centers_[i].y = new_centers[i].y / counts[i];
+            continue;
+        }
+        center_counts_[c] += counts[c];
+        const double eta = counts[c] / center_counts_[c];
+        for (std::size_t j = 0; j < d; ++j)
+        {
+            const double mean = sums(c, j) / counts[c];
+            centers_(c, j) += eta * (mean - centers_(c, j));
         }
     }
+    sync_centers();
 }
 
 // KMeans类的成员函数，用于判断聚类中心是否已经收敛
-bool KMeans::has_converged(const std::vector<Point> &old_centers) const
+bool KMeans::has_converged(const Matrix<double> &old_centers) const
 {
     // 遍历所有的聚类中心
     for (int i = 0; i < k_; ++i)
     {
-        // 计算旧聚类中心和新聚类中心之间的距离
-        // 如果距离大于一个很小的阈值（1e-6），则认为聚类中心还未收敛
-        if (distance(old_centers[i], centers_[i]) > 1e-6)
+        // 比较中心移动距离的平方与阈值（1e-6）的平方，省去开方
+        if (simd::squared_l2(old_centers.row(i), centers_.row(i), centers_.cols()) > 1e-12)
         {
             // 如果有任何一个聚类中心未收敛，则返回false
             return false;
@@ -114,28 +902,1873 @@ bool KMeans::has_converged(const std::vector<Point> &old_centers) const
     return true;
 }
 
-// KMeans类的fit函数，用于对数据进行K均值聚类
-void KMeans::fit(const std::vector<Point> &data)
+// 计算中心两两之间的欧氏距离，以及每个中心到最近的其他中心距离的一半
+// 若点到当前中心的距离不超过 half_min[c]，则它的标签不可能改变
+void KMeans::center_separation(Matrix<double> &center_dist, std::vector<double> &half_min) const
 {
-    // 初始化聚类中心
-    initialize_centers(data);
-
-    // 进行最大迭代次数的循环
-    for (int iter = 0; iter < max_iterations_; ++iter)
+    const std::size_t d = centers_.cols();
+    center_dist.resize(k_, k_, 0.0);
+    half_min.assign(k_, std::numeric_limits<double>::infinity());
+    for (int a = 0; a < k_; ++a)
     {
-        // 将数据点分配到最近的聚类中心
-        assign_clusters(data);
+        for (int b = a + 1; b < k_; ++b)
+        {
+            double dist = std::sqrt(simd::squared_l2(centers_.row(a), centers_.row(b), d));
+            center_dist(a, b) = dist;
+            center_dist(b, a) = dist;
+            half_min[a] = std::min(half_min[a], 0.5 * dist);
+            half_min[b] = std::min(half_min[b], 0.5 * dist);
+        }
+    }
+}
 
-        // 保存当前的聚类中心
-        std::vector<Point> old_centers = centers_;
+// 计算每个中心在本轮更新中移动的距离
+std::vector<double> KMeans::center_shifts(const Matrix<double> &old_centers) const
+{
+    std::vector<double> shifts(k_);
+    for (int c = 0; c < k_; ++c)
+    {
+        shifts[c] = std::sqrt(simd::squared_l2(old_centers.row(c), centers_.row(c), centers_.cols()));
+    }
+    return shifts;
+}
+
+// 标准 Lloyd 迭代：分配 -> 更新 -> 检查收敛
+template <typename T>
+void KMeans::run_lloyd(const MatrixView<T> &data)
+{
+    // 进行最大迭代次数的循环
+    for (int iter = 0; iter < max_iterations_; ++iter)
+    {
+        // 将数据点分配到最近的聚类中心
+        assign_clusters(data);
+
+        // 保存当前的聚类中心
+        Matrix<double> old_centers = centers_;
         // 更新聚类中心
         update_centers(data);
 
         // 检查是否收敛，如果收敛则输出信息并退出循环
         if (has_converged(old_centers))
         {
-            std::cout << "Converged at iteration " << iter + 1 << std::endl;
+            if (options_.verbose)
+            {
+                std::cout << "Converged at iteration " << iter + 1 << std::endl;
+            }
+            break;
+        }
+    }
+}
+
+// Elkan 算法：每个点维护到所属中心距离的上界 upper，以及到每个中心距离的下界 lower(i, j)。
+// 满足 upper <= lower(i, j) 或 upper <= cc(a, j) / 2 的中心 j 不可能更近，可以跳过
+template <typename T>
+void KMeans::run_elkan(const MatrixView<T> &data)
+{
+    const std::size_t n = data.rows();
+    const Matrix<T> &centers = working_centers<T>();
+    std::vector<T> upper(n);
+    Matrix<T> lower(n, k_);
+    Matrix<double> center_dist;
+    std::vector<double> half_min;
+    labels_.resize(n);
+
+    // 第一轮计算全部距离，得到精确的上下界
+    pool().parallel_for_blocks(n, kAssignGrain, [&](std::size_t begin, std::size_t end)
+                               {
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            T best = std::numeric_limits<T>::max();
+            int label = 0;
+            for (int j = 0; j < k_; ++j)
+            {
+                T dist = std::sqrt(simd::squared_l2(data, i, centers.row(j)));
+                lower(i, j) = dist;
+                if (dist < best)
+                {
+                    best = dist;
+                    label = j;
+                }
+            }
+            labels_[i] = label;
+            upper[i] = best;
+        } });
+    record_skipped(0);
+
+    for (int iter = 0; iter < max_iterations_; ++iter)
+    {
+        if (iter > 0)
+        {
+            center_separation(center_dist, half_min);
+            std::atomic<std::uint64_t> computed{0};
+            pool().parallel_for_blocks(n, kAssignGrain, [&](std::size_t begin, std::size_t end)
+                                       {
+                std::uint64_t local = 0;
+                for (std::size_t i = begin; i < end; ++i)
+                {
+                    int a = labels_[i];
+                    T u = upper[i];
+                    // 上界不超过到最近其他中心距离的一半，整个点都可以跳过
+                    if (u <= half_min[a])
+                    {
+                        continue;
+                    }
+                    bool tight = false;
+                    for (int j = 0; j < k_; ++j)
+                    {
+                        if (j == a)
+                        {
+                            continue;
+                        }
+                        T bound = std::max(lower(i, j), static_cast<T>(0.5 * center_dist(a, j)));
+                        if (u <= bound)
+                        {
+                            continue;
+                        }
+                        // 第一次无法剪枝时先收紧上界，再重新判断
+                        if (!tight)
+                        {
+                            u = std::sqrt(simd::squared_l2(data, i, centers.row(a)));
+                            lower(i, a) = u;
+                            ++local;
+                            tight = true;
+                            if (u <= bound)
+                            {
+                                continue;
+                            }
+                        }
+                        T dist = std::sqrt(simd::squared_l2(data, i, centers.row(j)));
+                        lower(i, j) = dist;
+                        ++local;
+                        if (dist < u)
+                        {
+                            a = j;
+                            u = dist;
+                        }
+                    }
+                    labels_[i] = a;
+                    upper[i] = u;
+                }
+                computed.fetch_add(local, std::memory_order_relaxed); });
+            record_skipped(static_cast<std::uint64_t>(n) * k_ - computed.load());
+        }
+
+        Matrix<double> old_centers = centers_;
+        update_centers(data);
+        if (has_converged(old_centers))
+        {
+            if (options_.verbose)
+            {
+                std::cout << "Converged at iteration " << iter + 1 << std::endl;
+            }
+            break;
+        }
+
+        // 中心移动后按三角不等式放宽上下界
+        std::vector<double> shifts = center_shifts(old_centers);
+        pool().parallel_for_blocks(n, kAssignGrain, [&](std::size_t begin, std::size_t end)
+                                   {
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                upper[i] += static_cast<T>(shifts[labels_[i]]);
+                T *lo = lower.row(i);
+                for (int j = 0; j < k_; ++j)
+                {
+                    lo[j] = std::max(lo[j] - static_cast<T>(shifts[j]), T(0));
+                }
+            } });
+    }
+}
+
+// Hamerly 算法：每个点只维护所属中心距离的上界 upper 和到其余所有中心距离的一个下界 lower。
+// 当 upper <= max(lower, half_min[a]) 时标签不会改变；否则收紧上界，仍不满足才扫描全部中心
+template <typename T>
+void KMeans::run_hamerly(const MatrixView<T> &data)
+{
+    const std::size_t n = data.rows();
+    const Matrix<T> &centers = working_centers<T>();
+    std::vector<T> upper(n);
+    std::vector<T> lower(n);
+    Matrix<double> center_dist;
+    std::vector<double> half_min;
+    labels_.resize(n);
+
+    // 扫描全部中心，记录最近和次近的距离；known 为已经算过距离的中心（-1 表示没有）
+    auto full_scan = [&](std::size_t i, int known, T known_dist)
+    {
+        T best = std::numeric_limits<T>::max();
+        T second = std::numeric_limits<T>::max();
+        int label = 0;
+        for (int j = 0; j < k_; ++j)
+        {
+            T dist = j == known ? known_dist : std::sqrt(simd::squared_l2(data, i, centers.row(j)));
+            if (dist < best)
+            {
+                second = best;
+                best = dist;
+                label = j;
+            }
+            else if (dist < second)
+            {
+                second = dist;
+            }
+        }
+        labels_[i] = label;
+        upper[i] = best;
+        lower[i] = second;
+    };
+
+    pool().parallel_for_blocks(n, kAssignGrain, [&](std::size_t begin, std::size_t end)
+                               {
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            full_scan(i, -1, T(0));
+        } });
+    record_skipped(0);
+
+    for (int iter = 0; iter < max_iterations_; ++iter)
+    {
+        if (iter > 0)
+        {
+            center_separation(center_dist, half_min);
+            std::atomic<std::uint64_t> computed{0};
+            pool().parallel_for_blocks(n, kAssignGrain, [&](std::size_t begin, std::size_t end)
+                                       {
+                std::uint64_t local = 0;
+                for (std::size_t i = begin; i < end; ++i)
+                {
+                    const int a = labels_[i];
+                    const T bound = std::max(lower[i], static_cast<T>(half_min[a]));
+                    if (upper[i] <= bound)
+                    {
+                        continue;
+                    }
+                    upper[i] = std::sqrt(simd::squared_l2(data, i, centers.row(a)));
+                    ++local;
+                    if (upper[i] <= bound)
+                    {
+                        continue;
+                    }
+                    full_scan(i, a, upper[i]);
+                    local += k_ - 1;
+                }
+                computed.fetch_add(local, std::memory_order_relaxed); });
+            record_skipped(static_cast<std::uint64_t>(n) * k_ - computed.load());
+        }
+
+        Matrix<double> old_centers = centers_;
+        update_centers(data);
+        if (has_converged(old_centers))
+        {
+            if (options_.verbose)
+            {
+                std::cout << "Converged at iteration " << iter + 1 << std::endl;
+            }
+            break;
+        }
+
+        // 所属中心的移动量放宽上界，其余中心中最大的移动量放宽下界
+        std::vector<double> shifts = center_shifts(old_centers);
+        int max_c = 0;
+        for (int c = 1; c < k_; ++c)
+        {
+            if (shifts[c] > shifts[max_c])
+            {
+                max_c = c;
+            }
+        }
+        double second_shift = 0.0;
+        for (int c = 0; c < k_; ++c)
+        {
+            if (c != max_c)
+            {
+                second_shift = std::max(second_shift, shifts[c]);
+            }
+        }
+        pool().parallel_for_blocks(n, kAssignGrain, [&](std::size_t begin, std::size_t end)
+                                   {
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                const int a = labels_[i];
+                upper[i] += static_cast<T>(shifts[a]);
+                lower[i] -= static_cast<T>(a == max_c ? second_shift : shifts[max_c]);
+            } });
+    }
+}
+
+// KMeans类的fit函数，用于对数据进行K均值聚类
+template <typename T>
+void KMeans::fit_impl(const MatrixView<T> &data)
+{
+    if (k_ <= 0)
+    {
+        throw std::invalid_argument("k must be positive");
+    }
+    if (data.empty())
+    {
+        throw std::invalid_argument("KMeans::fit requires non-empty data");
+    }
+    if (!euclidean_metric() && options_.algorithm != KMeansAlgorithm::Lloyd)
+    {
+        throw std::invalid_argument("KMeans: Manhattan and cosine metrics only support the Lloyd algorithm");
+    }
+
+    if (options_.n_init > 1)
+    {
+        fit_restarts(data);
+        return;
+    }
+
+    skipped_distances_ = 0;
+    skipped_per_iteration_.clear();
+    tree_.clear();
+    if (options_.algorithm == KMeansAlgorithm::Bisecting)
+    {
+        run_bisecting(data);
+        inertia_ = compute_inertia(data);
+        return;
+    }
+
+    // 初始化聚类中心
+    initialize_centers(data);
+    center_counts_.assign(k_, 0.0);
+
+    if (!euclidean_metric())
+    {
+        dispatch_metric(options_.metric, [&](auto m)
+                        {
+            using M = decltype(m);
+            run_lloyd_metric<T, M>(data);
+            inertia_ = metric_inertia<T, M>(data); });
+        return;
+    }
+
+    switch (options_.algorithm)
+    {
+    case KMeansAlgorithm::Elkan:
+        run_elkan(data);
+        break;
+    case KMeansAlgorithm::Hamerly:
+        run_hamerly(data);
+        break;
+    case KMeansAlgorithm::Yinyang:
+        run_yinyang(data);
+        break;
+    case KMeansAlgorithm::KDTree:
+        run_kdtree(data);
+        break;
+    default:
+        run_lloyd(data);
+        break;
+    }
+    inertia_ = compute_inertia(data);
+}
+
+template <typename T>
+const Matrix<T> &KMeans::working_tree_centers() const
+{
+    if constexpr (std::is_same_v<T, float>)
+    {
+        return tree_centers_f_;
+    }
+    else
+    {
+        return tree_centers_;
+    }
+}
+
+// 从根节点下降到叶子：每个内部节点只比较到左右两个子节点中心的距离，代价为 O(d·depth)
+template <typename T>
+int KMeans::descend_tree(const MatrixView<T> &data, std::size_t i) const
+{
+    const Matrix<T> &centers = working_tree_centers<T>();
+    int node = 0;
+    while (tree_[node].leaf < 0)
+    {
+        const KMeansTreeNode &cur = tree_[node];
+        const T left = simd::squared_l2(data, i, centers.row(cur.left));
+        const T right = simd::squared_l2(data, i, centers.row(cur.right));
+        node = right < left ? cur.right : cur.left;
+    }
+    return tree_[node].leaf;
+}
+
+// Yinyang 算法：把 k 个中心聚成 t 组，每个点维护到所属中心距离的上界 upper 和到每组（除所属中心外）最近中心距离的下界 lower(i, g)。
+// 全局过滤：upper 不超过所有组下界的最小值时跳过整个点；组过滤：只扫描 lower(i, g) < upper 的组；
+// 局部过滤：组内中心 j 在移动前的下界减去自身移动量 δ(j) 仍不小于当前最近距离时跳过 j。
+// 内存为 O(n·t)，介于 Hamerly 的 O(n) 与 Elkan 的 O(n·k) 之间
+template <typename T>
+void KMeans::run_yinyang(const MatrixView<T> &data)
+{
+    const std::size_t n = data.rows();
+    const Matrix<T> &centers = working_centers<T>();
+    labels_.resize(n);
+
+    // 对初始中心做一次小规模 KMeans 得到分组，组数默认为 k/10
+    int groups = options_.yinyang_groups > 0 ? options_.yinyang_groups : k_ / 10;
+    groups = std::min(std::max(groups, 1), k_);
+    std::vector<int> group_of(k_, 0);
+    if (groups > 1)
+    {
+        KMeansOptions group_options;
+        group_options.seed = mix_seed(options_.seed ? *options_.seed : rng_());
+        group_options.verbose = false;
+        KMeans grouping(groups, 5, group_options);
+        grouping.fit(centers_.view());
+        group_of = grouping.get_labels();
+    }
+    std::vector<std::vector<int>> members(groups);
+    for (int c = 0; c < k_; ++c)
+    {
+        members[group_of[c]].push_back(c);
+    }
+
+    std::vector<T> upper(n);
+    Matrix<T> lower(n, groups);
+
+    // 第一轮计算全部距离，得到精确的上界和每组的下界
+    pool().parallel_for_blocks(n, kAssignGrain, [&](std::size_t begin, std::size_t end)
+                               {
+        std::vector<T> dist(k_);
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            int label = 0;
+            for (int j = 0; j < k_; ++j)
+            {
+                dist[j] = std::sqrt(simd::squared_l2(data, i, centers.row(j)));
+                if (dist[j] < dist[label])
+                {
+                    label = j;
+                }
+            }
+            T *lo = lower.row(i);
+            std::fill(lo, lo + groups, std::numeric_limits<T>::max());
+            for (int j = 0; j < k_; ++j)
+            {
+                if (j != label)
+                {
+                    lo[group_of[j]] = std::min(lo[group_of[j]], dist[j]);
+                }
+            }
+            labels_[i] = label;
+            upper[i] = dist[label];
+        } });
+    record_skipped(0);
+
+    std::vector<double> shifts;
+    std::vector<double> group_shift(groups, 0.0);
+    for (int iter = 0; iter < max_iterations_; ++iter)
+    {
+        if (iter > 0)
+        {
+            std::atomic<std::uint64_t> computed{0};
+            pool().parallel_for_blocks(n, kAssignGrain, [&](std::size_t begin, std::size_t end)
+                                       {
+                std::uint64_t local = 0;
+                std::vector<T> old_lower(groups);
+                for (std::size_t i = begin; i < end; ++i)
+                {
+                    T *lo = lower.row(i);
+                    const int a0 = labels_[i];
+                    T global = std::numeric_limits<T>::max();
+                    for (int g = 0; g < groups; ++g)
+                    {
+                        // 保存移动前的组下界供局部过滤使用，再按组内最大移动量放宽
+                        old_lower[g] = lo[g];
+                        lo[g] = lo[g] - static_cast<T>(group_shift[g]);
+                        global = std::min(global, lo[g]);
+                    }
+                    upper[i] += static_cast<T>(shifts[a0]);
+                    if (upper[i] <= global)
+                    {
+                        continue;
+                    }
+                    // 收紧上界后再做一次全局过滤
+                    const T d0 = std::sqrt(simd::squared_l2(data, i, centers.row(a0)));
+                    ++local;
+                    upper[i] = d0;
+                    if (d0 <= global)
+                    {
+                        continue;
+                    }
+
+                    int a = a0;
+                    T u = d0;
+                    for (int g = 0; g < groups; ++g)
+                    {
+                        if (lo[g] >= u)
+                        {
+                            continue;
+                        }
+                        T group_lower = std::numeric_limits<T>::max();
+                        for (int j : members[g])
+                        {
+                            if (j == a)
+                            {
+                                continue;
+                            }
+                            T dist;
+                            if (j == a0)
+                            {
+                                // 原所属中心的精确距离已经算过
+                                dist = d0;
+                            }
+                            else
+                            {
+                                const T bound = old_lower[g] - static_cast<T>(shifts[j]);
+                                if (bound >= u)
+                                {
+                                    group_lower = std::min(group_lower, bound);
+                                    continue;
+                                }
+                                dist = std::sqrt(simd::squared_l2(data, i, centers.row(j)));
+                                ++local;
+                            }
+                            if (dist < u)
+                            {
+                                // 原最近中心变为其所在组的候选下界
+                                if (group_of[a] == g)
+                                {
+                                    group_lower = std::min(group_lower, u);
+                                }
+                                else
+                                {
+                                    lo[group_of[a]] = std::min(lo[group_of[a]], u);
+                                }
+                                a = j;
+                                u = dist;
+                            }
+                            else
+                            {
+                                group_lower = std::min(group_lower, dist);
+                            }
+                        }
+                        lo[g] = group_lower;
+                    }
+                    labels_[i] = a;
+                    upper[i] = u;
+                }
+                computed.fetch_add(local, std::memory_order_relaxed); });
+            record_skipped(static_cast<std::uint64_t>(n) * k_ - computed.load());
+        }
+
+        Matrix<double> old_centers = centers_;
+        update_centers(data);
+        if (has_converged(old_centers))
+        {
+            if (options_.verbose)
+            {
+                std::cout << "Converged at iteration " << iter + 1 << std::endl;
+            }
+            break;
+        }
+
+        shifts = center_shifts(old_centers);
+        std::fill(group_shift.begin(), group_shift.end(), 0.0);
+        for (int c = 0; c < k_; ++c)
+        {
+            group_shift[group_of[c]] = std::max(group_shift[group_of[c]], shifts[c]);
+        }
+    }
+}
+
+// KD 树过滤算法：在 fit 开始时建一次树，每轮遍历树完成分配，并直接得到每个簇的坐标和与样本数，
+// 不再需要逐点的 update_centers。树按固定的子树集合划分为并行任务，各任务的部分和按任务顺序合并，
+// 结果与线程数无关。迭代期间不写标签，收敛后再遍历一次写出最终标签。适合低维（2~3 维）数据
+template <typename T>
+void KMeans::run_kdtree(const MatrixView<T> &data)
+{
+    const std::size_t d = data.cols();
+    const KDTree<T> tree(data);
+    const std::vector<int> tasks = tree.frontier(kMaxSlices);
+    std::vector<int> all(k_);
+    for (int c = 0; c < k_; ++c)
+    {
+        all[c] = c;
+    }
+    std::vector<Matrix<double>> partial_sums(tasks.size());
+    std::vector<std::vector<std::size_t>> partial_counts(tasks.size());
+
+    // 遍历全部任务子树，返回合并后的坐标和与样本数
+    auto pass = [&](int *labels, Matrix<double> &sums, std::vector<std::size_t> &counts)
+    {
+        pool().parallel_for(tasks.size(), [&](std::size_t t)
+                            {
+            partial_sums[t].resize(k_, d, 0.0);
+            partial_counts[t].assign(k_, 0);
+            FilterPass<T> ctx{tree, data, centers_, working_centers<T>(), partial_sums[t], partial_counts[t],
+                              labels, {}, std::vector<double>(d)};
+            filter_node(ctx, tasks[t], all, 0); });
+        sums.resize(k_, d, 0.0);
+        counts.assign(k_, 0);
+        for (std::size_t t = 0; t < tasks.size(); ++t)
+        {
+            for (int c = 0; c < k_; ++c)
+            {
+                counts[c] += partial_counts[t][c];
+                for (std::size_t j = 0; j < d; ++j)
+                {
+                    sums(c, j) += partial_sums[t](c, j);
+                }
+            }
+        }
+    };
+
+    Matrix<double> sums;
+    std::vector<std::size_t> counts;
+    for (int iter = 0; iter < max_iterations_; ++iter)
+    {
+        pass(nullptr, sums, counts);
+        Matrix<double> old_centers = centers_;
+        for (int c = 0; c < k_; ++c)
+        {
+            // 空簇保持原中心
+            if (counts[c] == 0)
+            {
+                continue;
+            }
+            for (std::size_t j = 0; j < d; ++j)
+            {
+                centers_(c, j) = sums(c, j) / counts[c];
+            }
+        }
+        sync_centers();
+        center_counts_.assign(counts.begin(), counts.end());
+        if (has_converged(old_centers))
+        {
+            if (options_.verbose)
+            {
+                std::cout << "Converged at iteration " << iter + 1 << std::endl;
+            }
+            break;
+        }
+    }
+
+    labels_.resize(data.rows());
+    pass(labels_.data(), sums, counts);
+}
+
+// 记录一轮分配中跳过的距离计算次数
+void KMeans::record_skipped(std::uint64_t skipped)
+{
+    skipped_distances_ += skipped;
+    skipped_per_iteration_.push_back(skipped);
+}
+
+// 二分 KMeans：从包含全部样本的根节点开始，逐层把每个待分裂节点用 2-means 一分为二，
+// 并按两侧样本数比例分配剩余的叶子配额，直到每个节点的配额为 1 时成为叶子。比例限制在 [1/4, 3/4] 之内，
+// 树深为 O(log k)；每侧的配额不超过该侧互不相同的样本数，多出的配额交给另一侧，
+// 只有节点内互不相同的样本少于配额时才会出现重复的中心。
+// 同一层的节点互不依赖，在线程池上并行分裂；节点编号按层内顺序分配，2-means 的种子由节点编号派生，
+// 因此树的形状与线程数无关。最终中心为叶子内样本的均值，训练标签与预测一样沿树下降得到
+template <typename T>
+void KMeans::run_bisecting(const MatrixView<T> &data)
+{
+    const std::size_t n = data.rows();
+    const std::size_t d = data.cols();
+    const std::uint64_t base_seed = options_.seed ? *options_.seed : std::random_device{}();
+    const int threads = ThreadPool::resolve(options_.num_threads);
+
+    // 待处理节点：节点编号、所含样本下标以及分到的叶子配额
+    struct Pending
+    {
+        int node;
+        std::vector<std::size_t> rows;
+        int budget;
+    };
+    // 一次分裂的结果：两侧的样本、均值与互不相同的样本数（至多为父节点的配额）
+    struct Split
+    {
+        std::vector<std::size_t> rows[2];
+        AlignedVector<double> mean[2];
+        std::size_t distinct[2] = {0, 0};
+    };
+
+    auto mean_of = [&](const std::vector<std::size_t> &rows, AlignedVector<double> &mean)
+    {
+        mean.assign(d, 0.0);
+        for (std::size_t i : rows)
+        {
+            for (std::size_t j = 0; j < d; ++j)
+            {
+                mean[j] += data(i, j);
+            }
+        }
+        for (std::size_t j = 0; j < d; ++j)
+        {
+            mean[j] /= std::max<std::size_t>(1, rows.size());
+        }
+    };
+
+    std::vector<AlignedVector<double>> node_centers;
+    tree_.assign(1, KMeansTreeNode());
+    node_centers.emplace_back();
+    std::vector<Pending> frontier(1);
+    frontier[0].node = 0;
+    frontier[0].budget = k_;
+    frontier[0].rows.resize(n);
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        frontier[0].rows[i] = i;
+    }
+    mean_of(frontier[0].rows, node_centers[0]);
+
+    centers_.resize(k_, d);
+    center_counts_.assign(k_, 0.0);
+    int next_leaf = 0;
+    auto make_leaf = [&](const Pending &p)
+    {
+        tree_[p.node].leaf = next_leaf;
+        std::copy(node_centers[p.node].begin(), node_centers[p.node].end(), centers_.row(next_leaf));
+        center_counts_[next_leaf] = static_cast<double>(p.rows.size());
+        ++next_leaf;
+    };
+
+    while (!frontier.empty())
+    {
+        std::vector<Pending> splitting;
+        for (Pending &p : frontier)
+        {
+            if (p.budget <= 1)
+            {
+                make_leaf(p);
+            }
+            else
+            {
+                splitting.push_back(std::move(p));
+            }
+        }
+        if (splitting.empty())
+        {
             break;
         }
+
+        // 本层节点数少于线程数时，把多余的线程分给每个 2-means
+        KMeansOptions two_options = options_;
+        two_options.algorithm = KMeansAlgorithm::Lloyd;
+        two_options.n_init = 1;
+        two_options.verbose = false;
+        two_options.num_threads = std::max<int>(1, threads / static_cast<int>(splitting.size()));
+        std::vector<Split> splits(splitting.size());
+        pool().parallel_for(splitting.size(), [&](std::size_t t)
+                            {
+            const Pending &p = splitting[t];
+            Split &out = splits[t];
+            if (p.rows.size() >= 2)
+            {
+                Matrix<T> sub(p.rows.size(), d);
+                for (std::size_t r = 0; r < p.rows.size(); ++r)
+                {
+                    copy_row(data, p.rows[r], sub.row(r));
+                }
+                KMeansOptions opts = two_options;
+                opts.seed = mix_seed(base_seed + static_cast<std::uint64_t>(p.node));
+                KMeans two(2, max_iterations_, opts);
+                two.fit_impl(sub.view());
+                const std::vector<int> side = two.predict(sub.view());
+                for (std::size_t r = 0; r < p.rows.size(); ++r)
+                {
+                    out.rows[side[r]].push_back(p.rows[r]);
+                }
+            }
+            else
+            {
+                out.rows[0] = p.rows;
+            }
+            // 空的一侧沿用父节点中心，保证叶子总数仍为 k
+            for (int c = 0; c < 2; ++c)
+            {
+                if (out.rows[c].empty())
+                {
+                    out.mean[c] = node_centers[p.node];
+                }
+                else
+                {
+                    mean_of(out.rows[c], out.mean[c]);
+                }
+                out.distinct[c] = count_distinct_rows(data, out.rows[c], static_cast<std::size_t>(p.budget));
+            } });
+
+        // 按层内顺序分配子节点编号和叶子配额
+        std::vector<Pending> next;
+        for (std::size_t t = 0; t < splitting.size(); ++t)
+        {
+            Pending &p = splitting[t];
+            Split &sp = splits[t];
+            const std::size_t total = sp.rows[0].size() + sp.rows[1].size();
+            int left_budget = total == 0 ? p.budget / 2
+                                         : static_cast<int>(std::lround(static_cast<double>(p.budget) * sp.rows[0].size() / total));
+            // 每侧至少分到 1/4 的配额，保证树深为 O(log k)
+            const int min_share = std::max(1, p.budget / 4);
+            left_budget = std::min(std::max(left_budget, min_share), p.budget - min_share);
+            // 配额不超过该侧互不相同的样本数，多出的部分交给另一侧；两侧合计仍不够时左侧承担剩余的配额
+            const int caps[2] = {std::max(1, static_cast<int>(sp.distinct[0])), std::max(1, static_cast<int>(sp.distinct[1]))};
+            left_budget = std::min(left_budget, caps[0]);
+            if (p.budget - left_budget > caps[1])
+            {
+                left_budget = p.budget - caps[1];
+            }
+            const int budgets[2] = {left_budget, p.budget - left_budget};
+            for (int c = 0; c < 2; ++c)
+            {
+                const int child = static_cast<int>(tree_.size());
+                tree_.emplace_back();
+                node_centers.push_back(std::move(sp.mean[c]));
+                (c == 0 ? tree_[p.node].left : tree_[p.node].right) = child;
+                next.push_back(Pending{child, std::move(sp.rows[c]), budgets[c]});
+            }
+        }
+        frontier = std::move(next);
+    }
+
+    tree_centers_.resize(tree_.size(), d);
+    tree_centers_f_.resize(tree_.size(), d);
+    for (std::size_t node = 0; node < tree_.size(); ++node)
+    {
+        for (std::size_t j = 0; j < d; ++j)
+        {
+            tree_centers_(node, j) = node_centers[node][j];
+            tree_centers_f_(node, j) = static_cast<float>(node_centers[node][j]);
+        }
+    }
+    sync_centers();
+
+    labels_.resize(n);
+    pool().parallel_for_blocks(n, kAssignGrain, [&](std::size_t begin, std::size_t end)
+                               {
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            labels_[i] = descend_tree(data, i);
+        } });
+}
+
+// 每个样本到其标签对应中心的平方距离之和（有样本权重时加权），按切片求和再顺序合并，结果与线程数无关
+template <typename T>
+double KMeans::compute_inertia(const MatrixView<T> &data)
+{
+    const Matrix<T> &centers = working_centers<T>();
+    const SlicePlan plan = plan_slices(data.rows(), 0, 0);
+    std::vector<double> partial(plan.count, 0.0);
+    pool().parallel_for(plan.count, [&](std::size_t s)
+                        {
+        double sum = 0.0;
+        for (std::size_t i = plan.begin(s); i < plan.end(s); ++i)
+        {
+            const double dist = simd::squared_l2(data, i, centers.row(labels_[i]));
+            sum += sample_weights_ ? sample_weights_[i] * dist : dist;
+        }
+        partial[s] = sum; });
+    double total = 0.0;
+    for (double sum : partial)
+    {
+        total += sum;
+    }
+    return total;
+}
+
+// 按度量策略计算每个样本到其标签对应中心的距离之和（L1 距离之和、余弦距离之和等）
+template <typename T, typename M>
+double KMeans::metric_inertia(const MatrixView<T> &data)
+{
+    const Matrix<T> &centers = working_centers<T>();
+    const std::size_t d = data.cols();
+    const SlicePlan plan = plan_slices(data.rows(), 0, 0);
+    std::vector<double> partial(plan.count, 0.0);
+    pool().parallel_for(plan.count, [&](std::size_t s)
+                        {
+        AlignedVector<T> buffer(d);
+        double sum = 0.0;
+        for (std::size_t i = plan.begin(s); i < plan.end(s); ++i)
+        {
+            const T *x = contiguous_row(data, i, buffer.data());
+            const double dist = M::distance(M::score(x, centers.row(labels_[i]), d), simd::dot(x, x, d));
+            sum += sample_weights_ ? sample_weights_[i] * dist : dist;
+        }
+        partial[s] = sum; });
+    double total = 0.0;
+    for (double sum : partial)
+    {
+        total += sum;
+    }
+    return total;
+}
+
+// 任意度量下的 Lloyd 迭代：按策略分配，再按策略规定的方式更新中心。
+// 球面 KMeans 累加单位化后的样本 x / ||x||，与余弦距离只看方向的分配目标一致，各行的 1 / ||x|| 只算一次
+template <typename T, typename M>
+void KMeans::run_lloyd_metric(const MatrixView<T> &data)
+{
+    std::vector<double> inv_norms;
+    if constexpr (M::kUpdate == metric::Update::NormalizedMean)
+    {
+        normalize_centers();
+        inv_norms.resize(data.rows());
+        pool().parallel_for_blocks(data.rows(), kAssignGrain, [&](std::size_t begin, std::size_t end)
+                                   {
+            AlignedVector<T> buffer(data.cols());
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                const T *x = contiguous_row(data, i, buffer.data());
+                inv_norms[i] = inverse_norm(simd::dot(x, x, data.cols()));
+            } });
     }
-}
\ No newline at end of file
+    for (int iter = 0; iter < max_iterations_; ++iter)
+    {
+        // 每个任务对一段样本调用 predict_flat，内层循环按策略实例化
+        labels_.resize(data.rows());
+        pool().parallel_for_blocks(data.rows(), kAssignGrain, [&](std::size_t begin, std::size_t end)
+                                   { predict_flat<T, M>(data.row_block(begin, end), labels_.data() + begin); });
+
+        Matrix<double> old_centers = centers_;
+        if constexpr (M::kUpdate == metric::Update::Median)
+        {
+            update_medians(data);
+        }
+        else
+        {
+            update_centers(data, inv_norms.empty() ? nullptr : inv_norms.data());
+            if constexpr (M::kUpdate == metric::Update::NormalizedMean)
+            {
+                normalize_centers();
+            }
+        }
+
+        if (has_converged(old_centers))
+        {
+            if (options_.verbose)
+            {
+                std::cout << "Converged at iteration " << iter + 1 << std::endl;
+            }
+            break;
+        }
+    }
+}
+
+// k-medians 的中心更新：先按标签做计数排序把样本分组，再对每个簇逐维取中位数（偶数个时取较小的中位数）。
+// 每个簇独立计算，结果与线程数无关；空簇保持原中心
+template <typename T>
+void KMeans::update_medians(const MatrixView<T> &data)
+{
+    const std::size_t n = data.rows();
+    const std::size_t d = data.cols();
+    std::vector<std::size_t> offsets(k_ + 1, 0);
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        offsets[labels_[i] + 1]++;
+    }
+    for (int c = 0; c < k_; ++c)
+    {
+        offsets[c + 1] += offsets[c];
+    }
+    std::vector<std::size_t> order(n);
+    std::vector<std::size_t> cursor(offsets.begin(), offsets.end() - 1);
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        order[cursor[labels_[i]]++] = i;
+    }
+
+    pool().parallel_for(k_, [&](std::size_t c)
+                        {
+        const std::size_t begin = offsets[c];
+        const std::size_t count = offsets[c + 1] - begin;
+        if (count == 0)
+        {
+            return;
+        }
+        std::vector<T> values(count);
+        const std::size_t mid = (count - 1) / 2;
+        for (std::size_t j = 0; j < d; ++j)
+        {
+            for (std::size_t p = 0; p < count; ++p)
+            {
+                values[p] = data(order[begin + p], j);
+            }
+            std::nth_element(values.begin(), values.begin() + mid, values.end());
+            centers_(c, j) = static_cast<double>(values[mid]);
+        } });
+    center_counts_.resize(k_);
+    for (int c = 0; c < k_; ++c)
+    {
+        center_counts_[c] = static_cast<double>(offsets[c + 1] - offsets[c]);
+    }
+    sync_centers();
+}
+
+// 把每个中心缩放到单位长度（球面 KMeans），零向量保持不变
+void KMeans::normalize_centers()
+{
+    for (std::size_t c = 0; c < centers_.rows(); ++c)
+    {
+        double *center = centers_.row(c);
+        const double norm = std::sqrt(simd::dot(center, center, centers_.cols()));
+        if (norm > 0.0)
+        {
+            for (std::size_t j = 0; j < centers_.cols(); ++j)
+            {
+                center[j] /= norm;
+            }
+        }
+    }
+    sync_centers();
+}
+
+bool KMeans::euclidean_metric() const
+{
+    return options_.metric == KMeansMetric::Euclidean || options_.metric == KMeansMetric::SquaredEuclidean;
+}
+
+// n_init 次独立重启：每次重启是一个只读共享 data 的单次 KMeans，种子由基础种子和重启编号派生。
+// 重启之间在线程池上并发执行，线程按并发重启数平分；按 (inertia, 重启编号) 选出最优结果，与调度顺序无关
+template <typename Data>
+void KMeans::fit_restarts(const Data &data)
+{
+    const int threads = ThreadPool::resolve(options_.num_threads);
+    const int concurrent = std::min(options_.n_init, threads);
+    KMeansOptions run_options = options_;
+    run_options.n_init = 1;
+    run_options.verbose = false;
+    run_options.num_threads = std::max(1, threads / concurrent);
+    const std::uint64_t base_seed = options_.seed ? *options_.seed : std::random_device{}();
+
+    std::mutex best_mutex;
+    std::unique_ptr<KMeans> best;
+    std::size_t best_run = 0;
+    pool().parallel_for(options_.n_init, [&](std::size_t r)
+                        {
+        KMeansOptions opts = run_options;
+        opts.seed = mix_seed(base_seed + r);
+        auto run = std::make_unique<KMeans>(k_, max_iterations_, opts);
+        run->sample_weights_ = sample_weights_;
+        run->fit_impl(data);
+        // 只保留当前最优的一次，其余结果立即释放
+        std::lock_guard<std::mutex> lock(best_mutex);
+        if (!best || run->inertia_ < best->inertia_ || (run->inertia_ == best->inertia_ && r < best_run))
+        {
+            best = std::move(run);
+            best_run = r;
+        } });
+
+    labels_ = std::move(best->labels_);
+    centers_ = std::move(best->centers_);
+    centers_f_ = std::move(best->centers_f_);
+    center_norms_ = std::move(best->center_norms_);
+    center_norms_f_ = std::move(best->center_norms_f_);
+    center_counts_ = std::move(best->center_counts_);
+    tree_ = std::move(best->tree_);
+    tree_centers_ = std::move(best->tree_centers_);
+    tree_centers_f_ = std::move(best->tree_centers_f_);
+    skipped_distances_ = best->skipped_distances_;
+    skipped_per_iteration_ = std::move(best->skipped_per_iteration_);
+    inertia_ = best->inertia_;
+}
+
+void KMeans::fit(const std::vector<Point> &data)
+{
+    Matrix<double> points = Matrix<double>::from_points(data);
+    fit_impl(points.view());
+}
+
+void KMeans::fit(const MatrixView<float> &data)
+{
+    fit_impl(data);
+}
+
+void KMeans::fit(const MatrixView<double> &data)
+{
+    fit_impl(data);
+}
+
+// 带样本权重的 fit：权重只在本次调用期间生效，之后的 partial_fit / fit 恢复为等权
+template <typename T>
+void KMeans::fit_weighted_impl(const MatrixView<T> &data, const std::vector<double> &weights)
+{
+    if (weights.size() != data.rows())
+    {
+        throw std::invalid_argument("KMeans::fit: weights size does not match data");
+    }
+    for (double w : weights)
+    {
+        if (!(w >= 0.0) || !std::isfinite(w))
+        {
+            throw std::invalid_argument("KMeans::fit: weights must be finite and non-negative");
+        }
+    }
+    if (options_.algorithm == KMeansAlgorithm::KDTree || options_.algorithm == KMeansAlgorithm::Bisecting)
+    {
+        throw std::invalid_argument("KMeans: weighted fit does not support the KDTree and Bisecting algorithms");
+    }
+    if (options_.metric == KMeansMetric::Manhattan)
+    {
+        throw std::invalid_argument("KMeans: weighted fit does not support the Manhattan metric");
+    }
+    sample_weights_ = weights.data();
+    try
+    {
+        fit_impl(data);
+    }
+    catch (...)
+    {
+        sample_weights_ = nullptr;
+        throw;
+    }
+    sample_weights_ = nullptr;
+}
+
+void KMeans::fit(const MatrixView<float> &data, const std::vector<double> &weights)
+{
+    fit_weighted_impl(data, weights);
+}
+
+void KMeans::fit(const MatrixView<double> &data, const std::vector<double> &weights)
+{
+    fit_weighted_impl(data, weights);
+}
+
+// 在线更新：第一次调用时用这一批数据初始化中心，之后每批按 batch_size 切分为小批量依次更新
+template <typename T>
+void KMeans::partial_fit_impl(const MatrixView<T> &data)
+{
+    if (k_ <= 0)
+    {
+        throw std::invalid_argument("k must be positive");
+    }
+    if (!euclidean_metric())
+    {
+        throw std::invalid_argument("KMeans::partial_fit only supports Euclidean metrics");
+    }
+    if (data.empty())
+    {
+        return;
+    }
+    if (center_counts_.empty())
+    {
+        initialize_centers(data);
+        center_counts_.assign(k_, 0.0);
+    }
+    else if (data.cols() != centers_.cols())
+    {
+        throw std::invalid_argument("KMeans::partial_fit: dimension does not match the fitted centers");
+    }
+
+    // 小批量更新会移动中心，层次树不再有效，之后的预测改为扫描全部中心
+    tree_.clear();
+    const std::size_t batch = std::max<std::size_t>(1, options_.batch_size);
+    for (std::size_t begin = 0; begin < data.rows(); begin += batch)
+    {
+        minibatch_step(data.row_block(begin, std::min(data.rows(), begin + batch)));
+    }
+}
+
+// 流式训练：重置模型后逐块读取数据，直到 next_chunk 返回 false。同一时刻只持有调用方提供的一块数据
+template <typename T>
+void KMeans::fit_stream_impl(const std::function<bool(MatrixView<T> &)> &next_chunk)
+{
+    skipped_distances_ = 0;
+    skipped_per_iteration_.clear();
+    inertia_ = 0.0;
+    center_counts_.clear();
+    MatrixView<T> chunk;
+    while (next_chunk(chunk))
+    {
+        partial_fit_impl(chunk);
+    }
+    if (center_counts_.empty())
+    {
+        throw std::invalid_argument("KMeans::fit_stream requires non-empty data");
+    }
+}
+
+void KMeans::partial_fit(const MatrixView<float> &data)
+{
+    partial_fit_impl(data);
+}
+
+void KMeans::partial_fit(const MatrixView<double> &data)
+{
+    partial_fit_impl(data);
+}
+
+void KMeans::fit_stream(const std::function<bool(MatrixView<float> &)> &next_chunk)
+{
+    fit_stream_impl(next_chunk);
+}
+
+void KMeans::fit_stream(const std::function<bool(MatrixView<double> &)> &next_chunk)
+{
+    fit_stream_impl(next_chunk);
+}
+
+// 对查询矩阵按行分块，每块打包成连续的行优先缓冲区并计算 ||x||^2，再与每块中心做分块内积。
+// fn(begin, rows, center_begin, centers_in_block, x_norms, dots) 处理一个 (查询块, 中心块) 的内积结果，
+// dots 为 rows×kPredictCenters 的行优先矩阵。只使用局部缓冲区，可以在多个线程中并发调用
+template <typename T, typename F>
+void KMeans::for_each_dot_block(const MatrixView<T> &data, F &&fn) const
+{
+    check_query(data.cols());
+    const std::size_t n = data.rows();
+    const std::size_t d = data.cols();
+    const Matrix<T> &centers = working_centers<T>();
+    AlignedVector<T> packed;
+    AlignedVector<T> dots(kPredictRows * kPredictCenters);
+    T x_norms[kPredictRows];
+
+    for (std::size_t begin = 0; begin < n; begin += kPredictRows)
+    {
+        const std::size_t rows = std::min(kPredictRows, n - begin);
+        // 行优先且行间连续时直接使用原始数据，否则先打包
+        const T *block = nullptr;
+        if (data.row_major() && data.ld() == d)
+        {
+            block = data.row(begin);
+        }
+        else
+        {
+            packed.resize(rows * d);
+            for (std::size_t r = 0; r < rows; ++r)
+            {
+                copy_row(data, begin + r, packed.data() + r * d);
+            }
+            block = packed.data();
+        }
+        for (std::size_t r = 0; r < rows; ++r)
+        {
+            x_norms[r] = simd::dot(block + r * d, block + r * d, d);
+        }
+        for (std::size_t c0 = 0; c0 < static_cast<std::size_t>(k_); c0 += kPredictCenters)
+        {
+            const std::size_t kc = std::min(kPredictCenters, k_ - c0);
+            simd::dot_block(block, rows, centers.row(c0), kc, d, dots.data(), kPredictCenters);
+            fn(begin, rows, c0, kc, x_norms, dots.data());
+        }
+    }
+}
+
+// 查询矩阵必须在训练之后使用，且维度与中心一致
+void KMeans::check_query(std::size_t cols) const
+{
+    if (centers_.empty())
+    {
+        throw std::logic_error("KMeans: model is not fitted");
+    }
+    if (cols != centers_.cols())
+    {
+        throw std::invalid_argument("KMeans: query dimension does not match the fitted centers");
+    }
+}
+
+// 最近中心的标签和按度量报告的距离。层次模型沿树下降，其余按训练时的度量扫描全部中心；
+// 选出最近中心后再直接计算一次它的距离，避免展开式在点靠近中心时的相消误差
+template <typename T>
+void KMeans::predict_impl(const MatrixView<T> &data, std::vector<int> &labels, std::vector<T> *distances) const
+{
+    check_query(data.cols());
+    labels.resize(data.rows());
+    if (!tree_.empty())
+    {
+        // 层次模型：沿树下降，每层只比较两个子中心
+        for (std::size_t i = 0; i < data.rows(); ++i)
+        {
+            labels[i] = descend_tree(data, i);
+        }
+    }
+    else
+    {
+        dispatch_metric(options_.metric, [&](auto m)
+                        { predict_flat<T, decltype(m)>(data, labels.data()); });
+    }
+    if (distances)
+    {
+        dispatch_metric(options_.metric, [&](auto m)
+                        {
+            using M = decltype(m);
+            const Matrix<T> &centers = working_centers<T>();
+            const std::size_t d = data.cols();
+            AlignedVector<T> buffer(d);
+            distances->resize(data.rows());
+            for (std::size_t i = 0; i < data.rows(); ++i)
+            {
+                const T *x = contiguous_row(data, i, buffer.data());
+                (*distances)[i] = M::distance(M::score(x, centers.row(labels[i]), d), simd::dot(x, x, d));
+            } });
+    }
+}
+
+// 扫描全部中心求最近中心。可以展开为内积的度量（欧氏、余弦）走分块内积，其余度量直接调用策略的距离内核
+template <typename T, typename M>
+void KMeans::predict_flat(const MatrixView<T> &data, int *labels) const
+{
+    if constexpr (M::kViaDot)
+    {
+        const std::vector<T> &norms = working_norms<T>();
+        std::vector<T> best(data.rows(), std::numeric_limits<T>::max());
+        std::fill(labels, labels + data.rows(), 0);
+        for_each_dot_block(data, [&](std::size_t begin, std::size_t rows, std::size_t c0, std::size_t kc,
+                                     const T *x_norms, const T *dots)
+                           {
+            for (std::size_t r = 0; r < rows; ++r)
+            {
+                const T *row = dots + r * kPredictCenters;
+                T &b = best[begin + r];
+                for (std::size_t c = 0; c < kc; ++c)
+                {
+                    T score = M::score_from_dot(x_norms[r], row[c], norms[c0 + c]);
+                    if (score < b)
+                    {
+                        b = score;
+                        labels[begin + r] = static_cast<int>(c0 + c);
+                    }
+                }
+            } });
+    }
+    else
+    {
+        const Matrix<T> &centers = working_centers<T>();
+        const std::size_t d = data.cols();
+        AlignedVector<T> buffer(d);
+        for (std::size_t i = 0; i < data.rows(); ++i)
+        {
+            const T *x = contiguous_row(data, i, buffer.data());
+            T best = std::numeric_limits<T>::max();
+            int label = 0;
+            for (int c = 0; c < k_; ++c)
+            {
+                T score = M::score(x, centers.row(c), d);
+                if (score < best)
+                {
+                    best = score;
+                    label = c;
+                }
+            }
+            labels[i] = label;
+        }
+    }
+}
+
+// 每个查询点到全部 k 个中心的距离（n×k），距离按训练时的度量报告
+template <typename T>
+Matrix<T> KMeans::transform_impl(const MatrixView<T> &data) const
+{
+    check_query(data.cols());
+    Matrix<T> out(data.rows(), k_);
+    dispatch_metric(options_.metric, [&](auto m)
+                    {
+        using M = decltype(m);
+        if constexpr (M::kViaDot)
+        {
+            const std::vector<T> &norms = working_norms<T>();
+            for_each_dot_block(data, [&](std::size_t begin, std::size_t rows, std::size_t c0, std::size_t kc,
+                                         const T *x_norms, const T *dots)
+                               {
+                for (std::size_t r = 0; r < rows; ++r)
+                {
+                    const T *row = dots + r * kPredictCenters;
+                    T *dst = out.row(begin + r) + c0;
+                    for (std::size_t c = 0; c < kc; ++c)
+                    {
+                        dst[c] = M::distance(M::score_from_dot(x_norms[r], row[c], norms[c0 + c]), x_norms[r]);
+                    }
+                } });
+        }
+        else
+        {
+            const Matrix<T> &centers = working_centers<T>();
+            const std::size_t d = data.cols();
+            AlignedVector<T> buffer(d);
+            for (std::size_t i = 0; i < data.rows(); ++i)
+            {
+                const T *x = contiguous_row(data, i, buffer.data());
+                const T x_norm = simd::dot(x, x, d);
+                for (int c = 0; c < k_; ++c)
+                {
+                    out(i, c) = M::distance(M::score(x, centers.row(c), d), x_norm);
+                }
+            }
+        } });
+    return out;
+}
+
+std::vector<int> KMeans::predict(const MatrixView<float> &data) const
+{
+    std::vector<int> labels;
+    predict_impl<float>(data, labels, nullptr);
+    return labels;
+}
+
+std::vector<int> KMeans::predict(const MatrixView<double> &data) const
+{
+    std::vector<int> labels;
+    predict_impl<double>(data, labels, nullptr);
+    return labels;
+}
+
+void KMeans::predict(const MatrixView<float> &data, std::vector<int> &labels, std::vector<float> &distances) const
+{
+    predict_impl(data, labels, &distances);
+}
+
+void KMeans::predict(const MatrixView<double> &data, std::vector<int> &labels, std::vector<double> &distances) const
+{
+    predict_impl(data, labels, &distances);
+}
+
+Matrix<float> KMeans::transform(const MatrixView<float> &data) const
+{
+    return transform_impl(data);
+}
+
+Matrix<double> KMeans::transform(const MatrixView<double> &data) const
+{
+    return transform_impl(data);
+}
+
+// 稀疏输入的 fit：只支持 Lloyd 和可以展开为内积的度量（欧氏、平方欧氏、余弦）。
+// 距离按 ||x||^2 - 2 x·c + ||c||^2 计算，x·c 只遍历 x 的非零元素，||c||^2 使用 sync_centers 缓存的值
+template <typename T>
+void KMeans::fit_impl(const CsrMatrix<T> &data)
+{
+    if (k_ <= 0)
+    {
+        throw std::invalid_argument("k must be positive");
+    }
+    if (data.empty())
+    {
+        throw std::invalid_argument("KMeans::fit requires non-empty data");
+    }
+    if (options_.algorithm != KMeansAlgorithm::Lloyd)
+    {
+        throw std::invalid_argument("KMeans: sparse input only supports the Lloyd algorithm");
+    }
+    if (options_.metric == KMeansMetric::Manhattan)
+    {
+        throw std::invalid_argument("KMeans: sparse input does not support the Manhattan metric");
+    }
+
+    if (options_.n_init > 1)
+    {
+        fit_restarts(data);
+        return;
+    }
+
+    skipped_distances_ = 0;
+    skipped_per_iteration_.clear();
+    tree_.clear();
+    initialize_centers(data);
+    center_counts_.assign(k_, 0.0);
+    dispatch_metric(options_.metric, [&](auto m)
+                    {
+        using M = decltype(m);
+        if constexpr (M::kViaDot)
+        {
+            run_lloyd_sparse<T, M>(data);
+            inertia_ = sparse_inertia<T, M>(data);
+        } });
+}
+
+// 稀疏输入的初始中心：Random 均匀选取 k 个样本，其余方式使用 k-means++。
+// k-means++ 每选一个中心只需对每个样本做一次稀疏内积：D(x)^2 = ||x||^2 - 2 x·c + ||c||^2
+template <typename T>
+void KMeans::initialize_centers(const CsrMatrix<T> &data)
+{
+    rng_.seed(options_.seed ? *options_.seed : std::random_device{}());
+    const std::size_t n = data.rows();
+    const std::size_t d = data.cols();
+    centers_.resize(k_, d, 0.0);
+
+    auto set_center = [&](int c, std::size_t i)
+    {
+        double *center = centers_.row(c);
+        std::fill(center, center + d, 0.0);
+        simd::sparse_axpy(data.row_indices(i), data.row_values(i), data.row_nnz(i), 1.0, center);
+    };
+
+    if (options_.init == KMeansInit::Random)
+    {
+        std::uniform_int_distribution<std::size_t> dis(0, n - 1);
+        std::vector<std::size_t> picked;
+        if (n >= static_cast<std::size_t>(k_))
+        {
+            picked = sample_distinct(n, static_cast<std::size_t>(k_), rng_);
+        }
+        else
+        {
+            for (int i = 0; i < k_; ++i)
+            {
+                picked.push_back(dis(rng_));
+            }
+        }
+        for (int c = 0; c < k_; ++c)
+        {
+            set_center(c, picked[c]);
+        }
+        sync_centers();
+        return;
+    }
+
+    const std::size_t blocks = (n + kAssignGrain - 1) / kAssignGrain;
+    std::vector<double> x_norms(n);
+    std::vector<double> min_dist(n, std::numeric_limits<double>::infinity());
+    std::vector<double> block_sums(blocks, 0.0);
+    pool().parallel_for_blocks(n, kAssignGrain, [&](std::size_t begin, std::size_t end)
+                               {
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            const T *val = data.row_values(i);
+            x_norms[i] = simd::dot(val, val, data.row_nnz(i));
+        } });
+
+    std::size_t idx = std::uniform_int_distribution<std::size_t>(0, n - 1)(rng_);
+    for (int c = 0; c < k_; ++c)
+    {
+        set_center(c, idx);
+        if (c + 1 == k_)
+        {
+            break;
+        }
+        const double *center = centers_.row(c);
+        const double c_norm = x_norms[idx];
+        pool().parallel_for(blocks, [&](std::size_t b)
+                            {
+            const std::size_t end = std::min(n, (b + 1) * kAssignGrain);
+            double sum = 0.0;
+            for (std::size_t i = b * kAssignGrain; i < end; ++i)
+            {
+                const double dot = simd::sparse_dot(data.row_indices(i), data.row_values(i), data.row_nnz(i), center);
+                const double dist = std::max(0.0, x_norms[i] - 2.0 * dot + c_norm);
+                if (dist < min_dist[i])
+                {
+                    min_dist[i] = dist;
+                }
+                sum += min_dist[i];
+            }
+            block_sums[b] = sum; });
+
+        double total = 0.0;
+        for (double sum : block_sums)
+        {
+            total += sum;
+        }
+        if (total > 0.0)
+        {
+            idx = sample_weighted(min_dist, block_sums, kAssignGrain,
+                                  std::uniform_real_distribution<double>(0.0, total)(rng_));
+        }
+        else
+        {
+            idx = std::uniform_int_distribution<std::size_t>(0, n - 1)(rng_);
+        }
+    }
+    sync_centers();
+}
+
+// 稀疏输入的中心更新：每个切片把样本的非零元素累加到部分和，再按切片编号顺序合并，结果与线程数无关
+template <typename T>
+void KMeans::update_centers(const CsrMatrix<T> &data, const double *row_scale)
+{
+    const std::size_t n = data.rows();
+    const std::size_t d = data.cols();
+    const SlicePlan plan = plan_slices(n, k_, d);
+    std::vector<Matrix<double>> partial_sums(plan.count);
+    std::vector<std::vector<std::size_t>> partial_counts(plan.count);
+    pool().parallel_for(plan.count, [&](std::size_t s)
+                        {
+        partial_sums[s].resize(k_, d, 0.0);
+        partial_counts[s].assign(k_, 0);
+        for (std::size_t i = plan.begin(s); i < plan.end(s); ++i)
+        {
+            simd::sparse_axpy(data.row_indices(i), data.row_values(i), data.row_nnz(i),
+                              row_scale ? row_scale[i] : 1.0, partial_sums[s].row(labels_[i]));
+            partial_counts[s][labels_[i]]++;
+        } });
+
+    center_counts_.assign(k_, 0.0);
+    pool().parallel_for(k_, [&](std::size_t c)
+                        {
+        std::size_t count = 0;
+        for (std::size_t s = 0; s < plan.count; ++s)
+        {
+            count += partial_counts[s][c];
+        }
+        center_counts_[c] = static_cast<double>(count);
+        // 空簇保持原中心
+        if (count == 0)
+        {
+            return;
+        }
+        double *center = centers_.row(c);
+        std::fill(center, center + d, 0.0);
+        for (std::size_t s = 0; s < plan.count; ++s)
+        {
+            const double *acc = partial_sums[s].row(c);
+            for (std::size_t j = 0; j < d; ++j)
+            {
+                center[j] += acc[j];
+            }
+        }
+        for (std::size_t j = 0; j < d; ++j)
+        {
+            center[j] /= count;
+        } });
+    sync_centers();
+}
+
+template <typename T, typename M>
+void KMeans::predict_sparse(const CsrMatrix<T> &data, std::size_t begin, std::size_t end, int *labels) const
+{
+    const Matrix<T> &centers = working_centers<T>();
+    const std::vector<T> &norms = working_norms<T>();
+    for (std::size_t i = begin; i < end; ++i)
+    {
+        const std::uint32_t *idx = data.row_indices(i);
+        const T *val = data.row_values(i);
+        const std::size_t nnz = data.row_nnz(i);
+        const T x_norm = simd::dot(val, val, nnz);
+        T best = std::numeric_limits<T>::max();
+        int label = 0;
+        for (int c = 0; c < k_; ++c)
+        {
+            T score = M::score_from_dot(x_norm, simd::sparse_dot(idx, val, nnz, centers.row(c)), norms[c]);
+            if (score < best)
+            {
+                best = score;
+                label = c;
+            }
+        }
+        labels[i - begin] = label;
+    }
+}
+
+// 稀疏输入的 Lloyd 迭代，余弦度量下累加单位化后的样本，每次更新后把中心归一化
+template <typename T, typename M>
+void KMeans::run_lloyd_sparse(const CsrMatrix<T> &data)
+{
+    std::vector<double> inv_norms;
+    if constexpr (M::kUpdate == metric::Update::NormalizedMean)
+    {
+        normalize_centers();
+        inv_norms.resize(data.rows());
+        pool().parallel_for_blocks(data.rows(), kAssignGrain, [&](std::size_t begin, std::size_t end)
+                                   {
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                const T *val = data.row_values(i);
+                inv_norms[i] = inverse_norm(simd::dot(val, val, data.row_nnz(i)));
+            } });
+    }
+    labels_.resize(data.rows());
+    for (int iter = 0; iter < max_iterations_; ++iter)
+    {
+        pool().parallel_for_blocks(data.rows(), kAssignGrain, [&](std::size_t begin, std::size_t end)
+                                   { predict_sparse<T, M>(data, begin, end, labels_.data() + begin); });
+
+        Matrix<double> old_centers = centers_;
+        update_centers(data, inv_norms.empty() ? nullptr : inv_norms.data());
+        if constexpr (M::kUpdate == metric::Update::NormalizedMean)
+        {
+            normalize_centers();
+        }
+
+        if (has_converged(old_centers))
+        {
+            if (options_.verbose)
+            {
+                std::cout << "Converged at iteration " << iter + 1 << std::endl;
+            }
+            break;
+        }
+    }
+}
+
+// 稀疏输入的 inertia：欧氏度量下为平方距离之和，余弦度量下为余弦距离之和
+template <typename T, typename M>
+double KMeans::sparse_inertia(const CsrMatrix<T> &data)
+{
+    using D = std::conditional_t<std::is_base_of_v<metric::SquaredEuclidean, M>, metric::SquaredEuclidean, M>;
+    const Matrix<double> &centers = centers_;
+    const SlicePlan plan = plan_slices(data.rows(), 0, 0);
+    std::vector<double> partial(plan.count, 0.0);
+    pool().parallel_for(plan.count, [&](std::size_t s)
+                        {
+        double sum = 0.0;
+        for (std::size_t i = plan.begin(s); i < plan.end(s); ++i)
+        {
+            const T *val = data.row_values(i);
+            const std::size_t nnz = data.row_nnz(i);
+            const double x_norm = simd::dot(val, val, nnz);
+            const double dot = simd::sparse_dot(data.row_indices(i), val, nnz, centers.row(labels_[i]));
+            sum += D::distance(D::score_from_dot(x_norm, dot, center_norms_[labels_[i]]), x_norm);
+        }
+        partial[s] = sum; });
+    double total = 0.0;
+    for (double sum : partial)
+    {
+        total += sum;
+    }
+    return total;
+}
+
+template <typename T>
+std::vector<int> KMeans::predict_sparse_impl(const CsrMatrix<T> &data) const
+{
+    check_query(data.cols());
+    if (options_.metric == KMeansMetric::Manhattan)
+    {
+        throw std::invalid_argument("KMeans: sparse input does not support the Manhattan metric");
+    }
+    std::vector<int> labels(data.rows());
+    dispatch_metric(options_.metric, [&](auto m)
+                    {
+        using M = decltype(m);
+        if constexpr (M::kViaDot)
+        {
+            predict_sparse<T, M>(data, 0, data.rows(), labels.data());
+        } });
+    return labels;
+}
+
+void KMeans::fit(const CsrMatrix<float> &data)
+{
+    fit_impl(data);
+}
+
+void KMeans::fit(const CsrMatrix<double> &data)
+{
+    fit_impl(data);
+}
+
+std::vector<int> KMeans::predict(const CsrMatrix<float> &data) const
+{
+    return predict_sparse_impl(data);
+}
+
+std::vector<int> KMeans::predict(const CsrMatrix<double> &data) const
+{
+    return predict_sparse_impl(data);
+}
+
+// 内存映射数据上的 Lloyd 迭代。每轮按 kMappedBlockBytes 大小的行块顺序扫描：处理当前块时预读下一块，
+// 处理完后提示内核回收当前块，驻留内存只有约两块数据加上 n 个标签。
+// 块内分配和累加并行执行，块的部分和按块顺序合并，块大小与线程数无关，因此结果逐位一致。
+// 初始中心从按行号排序的随机抽样中选取，避免 k-means++ 在全量数据上扫描 k 遍
+template <typename T>
+void KMeans::fit_mapped_impl(const MappedMatrix<T> &data)
+{
+    if (k_ <= 0)
+    {
+        throw std::invalid_argument("k must be positive");
+    }
+    const std::size_t n = data.rows();
+    const std::size_t d = data.cols();
+    if (n == 0)
+    {
+        throw std::invalid_argument("KMeans::fit_mapped requires non-empty data");
+    }
+    if (!euclidean_metric())
+    {
+        throw std::invalid_argument("KMeans::fit_mapped only supports Euclidean metrics");
+    }
+    const MatrixView<T> all = data.view();
+    skipped_distances_ = 0;
+    skipped_per_iteration_.clear();
+    tree_.clear();
+
+    // 抽样初始化：有序抽取若干行复制到内存中，再在样本上执行配置的初始化方法
+    const std::size_t sample_size = std::min(n, std::max(kMappedInitSample, static_cast<std::size_t>(k_) * 64));
+    Matrix<T> sample(sample_size, d);
+    // 分层抽样：把 n 行均分为 sample_size 个区间，每个区间随机取一行，读取顺序与文件顺序一致
+    std::mt19937_64 gen(mix_seed(options_.seed ? *options_.seed : std::random_device{}()));
+    std::uniform_real_distribution<double> jitter(0.0, 1.0);
+    const double stride = static_cast<double>(n) / sample_size;
+    for (std::size_t s = 0; s < sample_size; ++s)
+    {
+        const std::size_t row = sample_size == n ? s : std::min(n - 1, static_cast<std::size_t>((s + jitter(gen)) * stride));
+        copy_row(all, row, sample.row(s));
+    }
+    initialize_centers(sample.view());
+
+    const std::size_t block_rows = std::max<std::size_t>(1, kMappedBlockBytes / data.row_bytes());
+    std::vector<int> labels(n);
+    Matrix<double> sums;
+    Matrix<double> block_sums;
+    std::vector<double> counts;
+    std::vector<double> block_counts;
+    data.file().advise_sequential();
+
+    for (int iter = 0; iter < max_iterations_; ++iter)
+    {
+        sums.resize(k_, d, 0.0);
+        counts.assign(k_, 0.0);
+        data.prefetch_rows(0, std::min(n, block_rows));
+        for (std::size_t begin = 0; begin < n; begin += block_rows)
+        {
+            const std::size_t end = std::min(n, begin + block_rows);
+            if (end < n)
+            {
+                data.prefetch_rows(end, std::min(n, end + block_rows));
+            }
+            const MatrixView<T> block = all.row_block(begin, end);
+            assign_clusters(block);
+            accumulate_clusters(block, block_sums, block_counts);
+            std::copy(labels_.begin(), labels_.end(), labels.begin() + begin);
+            for (int c = 0; c < k_; ++c)
+            {
+                counts[c] += block_counts[c];
+                for (std::size_t j = 0; j < d; ++j)
+                {
+                    sums(c, j) += block_sums(c, j);
+                }
+            }
+            data.release_rows(begin, end);
+        }
+
+        Matrix<double> old_centers = centers_;
+        for (int c = 0; c < k_; ++c)
+        {
+            // 空簇保持原中心
+            if (counts[c] == 0)
+            {
+                continue;
+            }
+            for (std::size_t j = 0; j < d; ++j)
+            {
+                centers_(c, j) = sums(c, j) / counts[c];
+            }
+        }
+        sync_centers();
+        center_counts_.assign(counts.begin(), counts.end());
+        if (has_converged(old_centers))
+        {
+            if (options_.verbose)
+            {
+                std::cout << "Converged at iteration " << iter + 1 << std::endl;
+            }
+            break;
+        }
+    }
+
+    // 与 fit 一致，inertia 按最后一轮的标签和更新后的最终中心计算，需要再顺序扫描一遍
+    double inertia = 0.0;
+    data.prefetch_rows(0, std::min(n, block_rows));
+    for (std::size_t begin = 0; begin < n; begin += block_rows)
+    {
+        const std::size_t end = std::min(n, begin + block_rows);
+        if (end < n)
+        {
+            data.prefetch_rows(end, std::min(n, end + block_rows));
+        }
+        labels_.assign(labels.begin() + begin, labels.begin() + end);
+        inertia += compute_inertia(all.row_block(begin, end));
+        data.release_rows(begin, end);
+    }
+    inertia_ = inertia;
+    labels_ = std::move(labels);
+}
+
+void KMeans::fit_mapped(const MappedMatrix<float> &data)
+{
+    fit_mapped_impl(data);
+}
+
+void KMeans::fit_mapped(const MappedMatrix<double> &data)
+{
+    fit_mapped_impl(data);
+}
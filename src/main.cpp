@@ -1,30 +1,26 @@
 #include "kmeans.h"
 #include "gradient_descent.h"
-#include <fstream>
-#include <sstream>
+#include <cstdio>
 #include <iomanip>
 #include <iostream>
+#include <stdexcept>
 #include "attention.h"
 #include "self_attention.hpp"
 #include "eigen_self_attention.hpp"
 #include "transformer/linear.hpp"
 
 std::vector<Point> load_data(const std::string &filename) {
-    std::vector<Point> data;
-    std::ifstream file(filename);
-    std::string line;
-    if (!file.is_open()) {
-        std::cerr << "Error: Could not open file '" << filename << "'\n";
+    try {
+        std::size_t skipped = 0;
+        std::vector<Point> data = load_points(filename, 0, &skipped);
+        if (skipped > 0) {
+            std::cerr << "Warning: skipped " << skipped << " malformed lines in '" << filename << "'\n";
+        }
         return data;
+    } catch (const std::runtime_error &) {
+        std::cerr << "Error: Could not open file '" << filename << "'\n";
+        return {};
     }
-    while (std::getline(file, line)) {
-        std::stringstream ss(line);
-        Point point;
-        ss >> point.x >> point.y;
-        data.push_back(point);
-    }
-
-    return data;
 }
 
 void test_kmeans() { // 加载数据
@@ -42,8 +38,8 @@ void test_kmeans() { // 加载数据
     const auto &centers = kmeans.get_centers();
 
     std::cout << "Cluster Centers:\n";
-    for (const auto &center: centers) {
-        std::cout << "(" << center.x << ", " << center.y << ")\n";
+    for (size_t c = 0; c < centers.rows(); ++c) {
+        std::cout << "(" << centers(c, 0) << ", " << centers(c, 1) << ")\n";
     }
 
     std::cout << "\nData Points and Labels:\n";
@@ -65,6 +61,16 @@ void test_sgd() {
     std::cout << "Intercept: " << sgd.get_intercept() << std::endl;
 }
 
+// 从标准输入在线训练，例如 cat points.txt | ./attention，或接在持续产生数据的管道后面
+void test_online_sgd() {
+    GradientDescent sgd(0.01, 1);
+    std::cout << "start online sgd" << std::endl;
+    std::size_t seen = sgd.online_gradient_descent(fileno(stdin));
+    std::cout << "Samples: " << seen << std::endl;
+    std::cout << "Slope: " << sgd.get_slope() << std::endl;
+    std::cout << "Intercept: " << sgd.get_intercept() << std::endl;
+}
+
 void test_autodiff();
 
 void test_attention() {
@@ -0,0 +1,194 @@
+#include "mapped_file.h"
+#include <algorithm>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+#ifndef _WIN32
+    // madvise 要求起始地址按页对齐：把区间向外扩展到页边界，并截断到映射范围内
+    bool page_range(const char *base, std::size_t size, std::size_t offset, std::size_t length,
+                    char *&start, std::size_t &bytes)
+    {
+        if (base == nullptr || offset >= size || length == 0)
+        {
+            return false;
+        }
+        static const std::size_t page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+        const std::size_t end = std::min(size, offset + length);
+        const std::size_t aligned = offset / page * page;
+        start = const_cast<char *>(base) + aligned;
+        bytes = end - aligned;
+        return true;
+    }
+#endif
+}
+
+MappedFile::MappedFile(const std::string &path)
+{
+#ifdef _WIN32
+    file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                        FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file_ == INVALID_HANDLE_VALUE)
+    {
+        file_ = nullptr;
+        throw std::runtime_error("MappedFile: cannot open " + path);
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file_, &size))
+    {
+        close();
+        throw std::runtime_error("MappedFile: cannot stat " + path);
+    }
+    size_ = static_cast<std::size_t>(size.QuadPart);
+    if (size_ == 0)
+    {
+        return;
+    }
+    mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping_ == nullptr)
+    {
+        close();
+        throw std::runtime_error("MappedFile: cannot map " + path);
+    }
+    data_ = static_cast<const char *>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+    if (data_ == nullptr)
+    {
+        close();
+        throw std::runtime_error("MappedFile: cannot map " + path);
+    }
+#else
+    fd_ = ::open(path.c_str(), O_RDONLY);
+    if (fd_ < 0)
+    {
+        throw std::runtime_error("MappedFile: cannot open " + path);
+    }
+    struct stat st;
+    if (::fstat(fd_, &st) != 0)
+    {
+        close();
+        throw std::runtime_error("MappedFile: cannot stat " + path);
+    }
+    size_ = static_cast<std::size_t>(st.st_size);
+    if (size_ == 0)
+    {
+        return;
+    }
+    void *addr = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd_, 0);
+    if (addr == MAP_FAILED)
+    {
+        close();
+        throw std::runtime_error("MappedFile: cannot map " + path);
+    }
+    data_ = static_cast<const char *>(addr);
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept
+{
+    *this = std::move(other);
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept
+{
+    if (this != &other)
+    {
+        close();
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
+#ifdef _WIN32
+        std::swap(file_, other.file_);
+        std::swap(mapping_, other.mapping_);
+#else
+        std::swap(fd_, other.fd_);
+#endif
+    }
+    return *this;
+}
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+    if (data_ != nullptr)
+    {
+        UnmapViewOfFile(data_);
+    }
+    if (mapping_ != nullptr)
+    {
+        CloseHandle(mapping_);
+    }
+    if (file_ != nullptr)
+    {
+        CloseHandle(file_);
+    }
+    mapping_ = nullptr;
+    file_ = nullptr;
+#else
+    if (data_ != nullptr)
+    {
+        ::munmap(const_cast<char *>(data_), size_);
+    }
+    if (fd_ >= 0)
+    {
+        ::close(fd_);
+    }
+    fd_ = -1;
+#endif
+    data_ = nullptr;
+    size_ = 0;
+}
+
+// Windows 上没有对应的 madvise 提示，依赖 FILE_FLAG_SEQUENTIAL_SCAN 和系统默认预读
+void MappedFile::advise_sequential() const
+{
+#ifndef _WIN32
+    if (data_ != nullptr)
+    {
+        ::madvise(const_cast<char *>(data_), size_, MADV_SEQUENTIAL);
+    }
+#endif
+}
+
+void MappedFile::advise_willneed(std::size_t offset, std::size_t length) const
+{
+#ifndef _WIN32
+    char *start;
+    std::size_t bytes;
+    if (page_range(data_, size_, offset, length, start, bytes))
+    {
+        ::madvise(start, bytes, MADV_WILLNEED);
+    }
+#else
+    (void)offset;
+    (void)length;
+#endif
+}
+
+void MappedFile::advise_dontneed(std::size_t offset, std::size_t length) const
+{
+#ifndef _WIN32
+    char *start;
+    std::size_t bytes;
+    if (page_range(data_, size_, offset, length, start, bytes))
+    {
+        ::madvise(start, bytes, MADV_DONTNEED);
+    }
+#else
+    (void)offset;
+    (void)length;
+#endif
+}
@@ -0,0 +1,384 @@
+#include "point_stream.h"
+#include "mapped_file.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    // 等待 fd 可读的单次超时（毫秒），超时后检查是否要求停止，析构不会被阻塞的读取卡住
+    constexpr int kPollMillis = 100;
+
+    bool is_blank(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    // from_chars 不接受前导 '+'，这里跳过一个，与 strtod 和流输入的写法兼容（"+-1" 仍然无效）
+    const char *skip_plus(const char *p, const char *end)
+    {
+        return p < end && *p == '+' && (p + 1 == end || p[1] != '-') ? p + 1 : p;
+    }
+
+    long read_some(int fd, char *buffer, std::size_t bytes)
+    {
+#ifdef _WIN32
+        return ::_read(fd, buffer, static_cast<unsigned>(std::min<std::size_t>(bytes, 1u << 30)));
+#else
+        return static_cast<long>(::read(fd, buffer, bytes));
+#endif
+    }
+
+    // fd 上此刻是否还有数据可以立即读取。普通文件总是可读
+    bool data_pending(int fd)
+    {
+#ifdef _WIN32
+        (void)fd;
+        return true;
+#else
+        pollfd p{fd, POLLIN, 0};
+        return ::poll(&p, 1, 0) > 0;
+#endif
+    }
+
+    // load_points 每块的字节数与每个线程在一个窗口中分到的块数：块数多于线程数，行长不均时负载仍然均衡
+    constexpr std::size_t kLoadChunkBytes = std::size_t(4) << 20;
+    constexpr std::size_t kLoadChunksPerThread = 4;
+
+    // 把 pos 向后移到行首（pos 已是行首时不变），没有下一行时返回 size
+    std::size_t line_start(const char *data, std::size_t size, std::size_t pos)
+    {
+        if (pos == 0 || pos >= size)
+        {
+            return std::min(pos, size);
+        }
+        const void *eol = std::memchr(data + pos - 1, '\n', size - pos + 1);
+        return eol ? static_cast<std::size_t>(static_cast<const char *>(eol) - data) + 1 : size;
+    }
+
+    // [begin, end) 中的行数（含空行），是解析结果的上界。end 是行尾，最后一行可以没有换行符。
+    // 逐个 memchr 换行符：libc 的向量化实现比逐字节比较快数倍
+    std::size_t count_lines(const char *begin, const char *end)
+    {
+        std::size_t lines = 0;
+        for (const char *p = begin; (p = static_cast<const char *>(std::memchr(p, '\n', end - p))) != nullptr; ++p)
+        {
+            ++lines;
+        }
+        return lines + (begin < end && end[-1] != '\n' ? 1 : 0);
+    }
+
+    // 解析 [begin, end) 中的每一行依次写入 out，返回写入的点数；无法解析的非空行计入 skipped
+    std::size_t parse_lines(const char *begin, const char *end, Point *out, std::size_t &skipped)
+    {
+        std::size_t count = 0;
+        skipped = 0;
+        for (const char *line = begin; line < end;)
+        {
+            const char *eol = static_cast<const char *>(std::memchr(line, '\n', end - line));
+            const char *stop = eol ? eol : end;
+            if (parse_point_line(line, stop, out[count]))
+            {
+                ++count;
+            }
+            else if (std::any_of(line, stop, [](char c)
+                                 { return !is_blank(c); }))
+            {
+                ++skipped;
+            }
+            line = eol ? eol + 1 : end;
+        }
+        return count;
+    }
+}
+
+bool parse_point_line(const char *begin, const char *end, Point &point)
+{
+    const char *p = begin;
+    while (p < end && is_blank(*p))
+    {
+        ++p;
+    }
+    auto result = std::from_chars(skip_plus(p, end), end, point.x);
+    if (result.ec != std::errc() || result.ptr == end || !is_blank(*result.ptr))
+    {
+        return false;
+    }
+    p = result.ptr;
+    while (p < end && is_blank(*p))
+    {
+        ++p;
+    }
+    result = std::from_chars(skip_plus(p, end), end, point.y);
+    return result.ec == std::errc();
+}
+
+std::vector<Point> load_points(const std::string &path, int num_threads, std::size_t *skipped_lines)
+{
+    MappedFile file(path);
+    file.advise_sequential();
+    const char *data = file.data();
+    const std::size_t size = file.size();
+    ThreadPool pool(num_threads);
+    const std::size_t chunks = static_cast<std::size_t>(pool.size()) * kLoadChunksPerThread;
+    const std::size_t window = chunks * kLoadChunkBytes;
+    std::vector<std::size_t> bounds(chunks + 1);
+    std::vector<std::size_t> offsets(chunks + 1);
+    std::vector<std::size_t> parsed(chunks);
+    std::vector<std::size_t> skipped(chunks);
+    std::vector<Point> points;
+    std::size_t total_skipped = 0;
+
+    for (std::size_t begin = 0; begin < size;)
+    {
+        const std::size_t end = line_start(data, size, begin + window);
+        file.advise_willneed(end, window);
+        // 块边界都落在行首，每块只包含完整的行
+        for (std::size_t c = 0; c <= chunks; ++c)
+        {
+            bounds[c] = line_start(data, size, std::min(end, begin + c * kLoadChunkBytes));
+        }
+        pool.parallel_for(chunks, [&](std::size_t c)
+                          { parsed[c] = count_lines(data + bounds[c], data + bounds[c + 1]); });
+        offsets[0] = points.size();
+        for (std::size_t c = 0; c < chunks; ++c)
+        {
+            offsets[c + 1] = offsets[c] + parsed[c];
+        }
+        // 按第一个窗口的平均行长估计总行数，一次预留，避免之后的窗口反复扩容复制
+        if (begin == 0 && end < size)
+        {
+            const double lines_per_byte = static_cast<double>(offsets[chunks]) / end;
+            points.reserve(static_cast<std::size_t>(lines_per_byte * size * 1.05) + chunks);
+        }
+        points.resize(offsets[chunks]);
+        Point *out = points.data();
+        pool.parallel_for(chunks, [&](std::size_t c)
+                          { parsed[c] = parse_lines(data + bounds[c], data + bounds[c + 1], out + offsets[c], skipped[c]); });
+        // 有空行或无法解析的行时，各块的结果向前移动，补上空出的位置
+        std::size_t count = offsets[0];
+        for (std::size_t c = 0; c < chunks; ++c)
+        {
+            if (count != offsets[c])
+            {
+                std::copy(points.begin() + offsets[c], points.begin() + offsets[c] + parsed[c], points.begin() + count);
+            }
+            count += parsed[c];
+            total_skipped += skipped[c];
+        }
+        points.resize(count);
+        file.advise_dontneed(begin, end - begin);
+        begin = end;
+    }
+    if (skipped_lines)
+    {
+        *skipped_lines = total_skipped;
+    }
+    return points;
+}
+
+PointStream::PointStream(int fd, const PointStreamOptions &options)
+    : fd_(fd), options_(options)
+{
+    if (fd < 0)
+    {
+        throw std::invalid_argument("PointStream: invalid file descriptor");
+    }
+    if (options.chunk_points == 0 || options.first_chunk_points == 0 || options.queue_chunks == 0 ||
+        options.read_bytes == 0)
+    {
+        throw std::invalid_argument("PointStream: chunk sizes, queue capacity and read size must be positive");
+    }
+    parser_ = std::thread([this]
+                          { parse_loop(); });
+}
+
+PointStream::~PointStream()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    space_cv_.notify_all();
+    parser_.join();
+}
+
+bool PointStream::next(std::vector<Point> &chunk)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    ready_cv_.wait(lock, [&]
+                   { return !queue_.empty() || done_; });
+    if (queue_.empty())
+    {
+        if (error_)
+        {
+            std::rethrow_exception(error_);
+        }
+        return false;
+    }
+    if (chunk.capacity() > 0 && free_.size() < options_.queue_chunks)
+    {
+        chunk.clear();
+        free_.push_back(std::move(chunk));
+    }
+    chunk = std::move(queue_.front());
+    queue_.pop_front();
+    space_cv_.notify_one();
+    return true;
+}
+
+bool PointStream::push(std::vector<Point> &chunk)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    space_cv_.wait(lock, [&]
+                   { return stop_ || queue_.size() < options_.queue_chunks; });
+    if (stop_)
+    {
+        return false;
+    }
+    queue_.push_back(std::move(chunk));
+    ready_cv_.notify_one();
+    return true;
+}
+
+std::vector<Point> PointStream::take_buffer()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (free_.empty())
+    {
+        return {};
+    }
+    std::vector<Point> buffer = std::move(free_.back());
+    free_.pop_back();
+    return buffer;
+}
+
+bool PointStream::wait_readable()
+{
+#ifndef _WIN32
+    pollfd p{fd_, POLLIN, 0};
+    for (;;)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stop_)
+            {
+                return false;
+            }
+        }
+        // 出错或对端关闭时同样返回，由随后的 read() 报告结果
+        if (::poll(&p, 1, kPollMillis) != 0)
+        {
+            return true;
+        }
+    }
+#else
+    std::lock_guard<std::mutex> lock(mutex_);
+    return !stop_;
+#endif
+}
+
+// 读取缓冲区中只解析完整的行，最后一个换行符之后的不完整行移到缓冲区开头，与下一次读取的数据拼接。
+// 一行比缓冲区还长时把缓冲区加倍
+void PointStream::parse_loop()
+{
+    try
+    {
+        std::vector<char> buffer(options_.read_bytes);
+        std::size_t carry = 0;
+        std::size_t target = std::min(options_.first_chunk_points, options_.chunk_points);
+        std::vector<Point> chunk = take_buffer();
+        // 当前块凑满 target 个点后交给消费者，之后的块逐步变大
+        auto emit = [&]
+        {
+            if (!push(chunk))
+            {
+                return false;
+            }
+            chunk = take_buffer();
+            target = std::min(target * 2, options_.chunk_points);
+            return true;
+        };
+
+        for (bool eof = false; !eof;)
+        {
+            if (carry == buffer.size())
+            {
+                buffer.resize(buffer.size() * 2);
+            }
+            if (!wait_readable())
+            {
+                return;
+            }
+            const long got = read_some(fd_, buffer.data() + carry, buffer.size() - carry);
+            if (got < 0)
+            {
+                if (errno == EINTR || errno == EAGAIN)
+                {
+                    continue;
+                }
+                throw std::runtime_error(std::string("PointStream: read failed: ") + std::strerror(errno));
+            }
+            eof = got == 0;
+            const char *line = buffer.data();
+            const char *end = line + carry + got;
+            for (;;)
+            {
+                const char *eol = static_cast<const char *>(std::memchr(line, '\n', end - line));
+                // 流结束时最后一行可以没有换行符
+                if (eol == nullptr && !(eof && line < end))
+                {
+                    break;
+                }
+                const char *stop = eol ? eol : end;
+                Point point;
+                if (parse_point_line(line, stop, point))
+                {
+                    chunk.push_back(point);
+                    if (chunk.size() >= target && !emit())
+                    {
+                        return;
+                    }
+                }
+                else if (std::any_of(line, stop, [](char c)
+                                     { return !is_blank(c); }))
+                {
+                    skipped_.fetch_add(1, std::memory_order_relaxed);
+                }
+                line = eol ? eol + 1 : end;
+            }
+            carry = static_cast<std::size_t>(end - line);
+            std::memmove(buffer.data(), line, carry);
+            // 管道中暂时没有更多数据时，已经解析的样本先交给消费者，不等凑满一块
+            if (!eof && !chunk.empty() && !data_pending(fd_) && !emit())
+            {
+                return;
+            }
+        }
+        if (!chunk.empty() && !push(chunk))
+        {
+            return;
+        }
+    }
+    catch (...)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        error_ = std::current_exception();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        done_ = true;
+    }
+    ready_cv_.notify_all();
+}
@@ -0,0 +1,130 @@
+#include "thread_pool.h"
+#include <algorithm>
+
+namespace
+{
+    // 当前线程正在为哪个线程池执行任务，用于检测嵌套调用
+    thread_local ThreadPool *tls_current_pool = nullptr;
+}
+
+int ThreadPool::resolve(int num_threads)
+{
+    if (num_threads > 0)
+    {
+        return num_threads;
+    }
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+ThreadPool::ThreadPool(int num_threads)
+{
+    const int total = resolve(num_threads);
+    workers_.reserve(total - 1);
+    for (int i = 1; i < total; ++i)
+    {
+        workers_.emplace_back([this]
+                              { worker_loop(); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    start_cv_.notify_all();
+    for (auto &worker : workers_)
+    {
+        worker.join();
+    }
+}
+
+void ThreadPool::worker_loop()
+{
+    std::uint64_t seen = 0;
+    for (;;)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        start_cv_.wait(lock, [&]
+                       { return stop_ || generation_ != seen; });
+        if (stop_)
+        {
+            return;
+        }
+        seen = generation_;
+        lock.unlock();
+
+        run_tasks();
+
+        lock.lock();
+        if (--active_ == 0)
+        {
+            done_cv_.notify_one();
+        }
+    }
+}
+
+// 从共享计数器中领取任务直到全部领取完
+void ThreadPool::run_tasks()
+{
+    ThreadPool *previous = tls_current_pool;
+    tls_current_pool = this;
+    for (;;)
+    {
+        const std::size_t task = next_.fetch_add(1, std::memory_order_relaxed);
+        if (task >= job_size_)
+        {
+            break;
+        }
+        try
+        {
+            job_(task);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!error_)
+            {
+                error_ = std::current_exception();
+            }
+        }
+    }
+    tls_current_pool = previous;
+}
+
+bool ThreadPool::run_inline(std::size_t n_tasks) const
+{
+    return workers_.empty() || n_tasks <= 1 || tls_current_pool == this;
+}
+
+void ThreadPool::dispatch(std::size_t n_tasks, TaskRef job)
+{
+    std::lock_guard<std::mutex> submit(submit_mutex_);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        job_ = job;
+        job_size_ = n_tasks;
+        next_.store(0, std::memory_order_relaxed);
+        active_ = workers_.size();
+        error_ = nullptr;
+        ++generation_;
+    }
+    start_cv_.notify_all();
+
+    run_tasks();
+
+    std::exception_ptr error;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_cv_.wait(lock, [&]
+                      { return active_ == 0; });
+        job_ = TaskRef{nullptr, nullptr};
+        error = error_;
+        error_ = nullptr;
+    }
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
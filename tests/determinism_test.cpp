@@ -0,0 +1,109 @@
+// KMeans 的分配 / 更新与小批量梯度下降都按固定顺序合并各线程的部分和，
+// 1 个线程与 8 个线程训练出的中心和权重必须逐位相同
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "gradient_descent.h"
+#include "kmeans.h"
+#include "matrix.h"
+
+namespace
+{
+    // 固定种子的随机特征矩阵与线性目标 y = X·w + b + 噪声
+    void make_regression(std::size_t n, std::size_t d, std::uint64_t seed, Matrix<double> &X, std::vector<double> &y)
+    {
+        std::mt19937_64 rng(seed);
+        std::normal_distribution<double> normal(0.0, 1.0);
+        std::vector<double> w(d);
+        for (double &v : w)
+        {
+            v = normal(rng);
+        }
+        X.resize(n, d, 0.0);
+        y.assign(n, 0.5);
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            for (std::size_t j = 0; j < d; ++j)
+            {
+                X(i, j) = normal(rng);
+                y[i] += w[j] * X(i, j);
+            }
+            y[i] += 0.1 * normal(rng);
+        }
+    }
+
+    Matrix<double> kmeans_centers(const Matrix<double> &X, KMeansAlgorithm algorithm, int threads)
+    {
+        KMeansOptions options;
+        options.algorithm = algorithm;
+        options.num_threads = threads;
+        options.seed = 3;
+        options.verbose = false;
+        KMeans model(16, 30, options);
+        model.fit(X.view());
+        return model.get_centers();
+    }
+
+    std::vector<double> gd_weights(const Matrix<double> &X, const std::vector<double> &y, int threads)
+    {
+        GradientDescent gd(0.05, 20);
+        gd.set_num_threads(threads);
+        gd.set_seed(11);
+        gd.set_loss_interval(0);
+        gd.mini_batch_gradient_descent(X.view(), y, 512);
+        std::vector<double> params = gd.get_weights();
+        params.push_back(gd.get_intercept());
+        return params;
+    }
+
+    bool same_matrix(const Matrix<double> &a, const Matrix<double> &b)
+    {
+        if (a.rows() != b.rows() || a.cols() != b.cols())
+        {
+            return false;
+        }
+        for (std::size_t i = 0; i < a.rows(); ++i)
+        {
+            for (std::size_t j = 0; j < a.cols(); ++j)
+            {
+                if (a(i, j) != b(i, j))
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+}
+
+int main()
+{
+    int failures = 0;
+    Matrix<double> X;
+    std::vector<double> y;
+    make_regression(20000, 8, 5, X, y);
+
+    const struct
+    {
+        KMeansAlgorithm algorithm;
+        const char *name;
+    } algorithms[] = {
+        {KMeansAlgorithm::Lloyd, "Lloyd"},
+        {KMeansAlgorithm::Elkan, "Elkan"},
+    };
+    for (const auto &entry : algorithms)
+    {
+        if (!same_matrix(kmeans_centers(X, entry.algorithm, 1), kmeans_centers(X, entry.algorithm, 8)))
+        {
+            std::printf("FAIL: KMeans %s centers depend on the thread count\n", entry.name);
+            ++failures;
+        }
+    }
+
+    if (gd_weights(X, y, 1) != gd_weights(X, y, 8))
+    {
+        std::printf("FAIL: mini-batch gradient descent weights depend on the thread count\n");
+        ++failures;
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,98 @@
+// Elkan、Hamerly、Yinyang 与 KD 树过滤都只是跳过不可能改变分配的距离计算，
+// 在相同种子和数据上，它们的标签和中心必须与 Lloyd 完全一致
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "kmeans.h"
+#include "matrix.h"
+
+namespace
+{
+    // 固定种子的高斯团数据，n×d。坐标取整数，坐标和与求和顺序无关，
+    // KD 树按子树缓存的部分和得到的中心才能与逐点累加的 Lloyd 逐位相同
+    Matrix<double> make_blobs(std::size_t n, std::size_t d, std::size_t clusters, std::uint64_t seed)
+    {
+        std::mt19937_64 rng(seed);
+        std::uniform_real_distribution<double> center(-20.0, 20.0);
+        std::normal_distribution<double> noise(0.0, 2.0);
+        Matrix<double> means(clusters, d);
+        for (std::size_t c = 0; c < clusters; ++c)
+        {
+            for (std::size_t j = 0; j < d; ++j)
+            {
+                means(c, j) = center(rng);
+            }
+        }
+        Matrix<double> data(n, d);
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            const std::size_t c = i % clusters;
+            for (std::size_t j = 0; j < d; ++j)
+            {
+                data(i, j) = std::round(means(c, j) + noise(rng));
+            }
+        }
+        return data;
+    }
+
+    KMeans fit(const Matrix<double> &data, int k, KMeansAlgorithm algorithm)
+    {
+        KMeansOptions options;
+        options.algorithm = algorithm;
+        options.seed = 42;
+        options.verbose = false;
+        KMeans model(k, 50, options);
+        model.fit(data.view());
+        return model;
+    }
+
+    bool same_result(const KMeans &expected, const KMeans &actual)
+    {
+        if (expected.get_labels() != actual.get_labels())
+        {
+            return false;
+        }
+        const Matrix<double> &a = expected.get_centers();
+        const Matrix<double> &b = actual.get_centers();
+        for (std::size_t c = 0; c < a.rows(); ++c)
+        {
+            for (std::size_t j = 0; j < a.cols(); ++j)
+            {
+                if (a(c, j) != b(c, j))
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+}
+
+int main()
+{
+    const struct
+    {
+        KMeansAlgorithm algorithm;
+        const char *name;
+    } algorithms[] = {
+        {KMeansAlgorithm::Elkan, "Elkan"},
+        {KMeansAlgorithm::Hamerly, "Hamerly"},
+        {KMeansAlgorithm::Yinyang, "Yinyang"},
+        {KMeansAlgorithm::KDTree, "KDTree"},
+    };
+
+    int failures = 0;
+    const Matrix<double> data = make_blobs(2000, 3, 12, 7);
+    const int k = 10;
+    const KMeans lloyd = fit(data, k, KMeansAlgorithm::Lloyd);
+    for (const auto &entry : algorithms)
+    {
+        if (!same_result(lloyd, fit(data, k, entry.algorithm)))
+        {
+            std::printf("FAIL: %s differs from Lloyd\n", entry.name);
+            ++failures;
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}